@@ -0,0 +1,245 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * Headless benchmark of the layouts, size hints and client list operations.
+ * dwm.c is included so that its static functions can be driven directly
+ * against synthetic monitors; nothing here talks to an X server.
+ *
+ * Every line reports the nanoseconds and ecalloc() calls per operation.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "util.h"
+
+static unsigned long nalloc;
+
+void *
+countcalloc(size_t nmemb, size_t size)
+{
+  nalloc++;
+  return ecalloc(nmemb, size);
+}
+
+#define ecalloc countcalloc
+#define main dwmmain
+#include "dwm.c"
+#undef main
+#undef ecalloc
+
+static const unsigned int nclients[] = { 1, 10, 100, 1000, 10000 };
+
+static void
+report(const char *what, const char *params, unsigned int n, unsigned int reps,
+    unsigned long long t, unsigned long allocs)
+{
+  printf("%-16s %-24s %6u clients %12.1f ns/op %8.3f allocs/op\n", what, params, n,
+      (double)t / reps, (double)allocs / reps);
+}
+
+static unsigned int
+repsfor(unsigned int n)
+{
+  return MAX(20, 2000000 / (n + 1));
+}
+
+static Monitor *
+benchmon(unsigned int n)
+{
+  unsigned int i;
+  Client *c;
+  Monitor *m;
+
+  m = createmon();
+  m->mx = m->wx = 0;
+  m->my = 0;
+  m->wy = bh;
+  m->mw = m->ww = sw;
+  m->mh = sh;
+  m->wh = sh - bh;
+  mons = selmon = m;
+  for (i = 0; i < n; i++) {
+    c = allocclient();
+    c->mon = m;
+    c->tags = i % 7 ? 1 : 1 << (i % LENGTH(tags));
+    c->x = c->y = 0;
+    c->w = c->h = 100 + i % 50;
+    c->bw = borderpx;
+    if (i % 3 == 0) { /* a terminal like client */
+      c->cold->basew = c->cold->baseh = 4;
+      c->cold->incw = 7;
+      c->cold->inch = 15;
+    }
+    if (i % 5 == 0) {
+      c->cold->minw = c->cold->minh = 50;
+      c->cold->mina = 0.5;
+      c->cold->maxa = 2.0;
+    }
+    attach(c);
+    attachstack(c);
+  }
+  m->sel = m->clients;
+  return m;
+}
+
+static void
+freemon(Monitor *m)
+{
+  Client *c;
+
+  while ((c = m->clients)) {
+    detach(c);
+    detachstack(c);
+    freeclient(c);
+  }
+  free(m->vis);
+  free(m->pertag);
+  free(m);
+  mons = selmon = NULL;
+}
+
+static void
+benchlayout(const Layout *l, unsigned int n, unsigned int nmaster, float mf, int gaps)
+{
+  char params[64];
+  unsigned int i, k, reps = repsfor(n);
+  unsigned long long t;
+  unsigned long a;
+  Client *c;
+  Monitor *m = benchmon(n);
+
+  m->nmaster = nmaster;
+  m->mfact = mf;
+  gapsenabled = gaps;
+  tiled = ecalloc(m->nclients, sizeof(Client *));
+  geoms = ecalloc(m->nclients, sizeof(Geom));
+  a = nalloc;
+  t = getnsec();
+  for (i = 0; i < reps; i++) {
+    /* what arrangemon() does short of configuring the windows */
+    for (k = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next))
+      tiled[k++] = c;
+    if (k)
+      l->arrange(m, tiled, geoms, k);
+  }
+  t = getnsec() - t;
+  snprintf(params, sizeof params, "nmaster=%u mfact=%.2f gaps=%d", nmaster, mf, gaps);
+  report(l->symbol, params, n, reps, t, nalloc - a);
+  free(tiled);
+  free(geoms);
+  tiled = NULL;
+  geoms = NULL;
+  freemon(m);
+}
+
+static void
+benchsizehints(unsigned int n)
+{
+  unsigned int i, reps = repsfor(n);
+  int x, y, w, h, bw;
+  unsigned long long t;
+  unsigned long a;
+  Client *c;
+  Monitor *m = benchmon(n);
+
+  for (c = m->clients; c; c = c->next)
+    c->isfloating = 1; /* hints are only honoured for floating clients */
+  a = nalloc;
+  t = getnsec();
+  for (i = 0; i < reps; i++)
+    for (c = m->clients; c; c = c->next) {
+      x = c->x + 1;
+      y = c->y;
+      w = c->w + i % 13;
+      h = c->h + i % 17;
+      bw = c->bw;
+      applysizehints(c, &x, &y, &w, &h, &bw, i & 1);
+    }
+  t = getnsec() - t;
+  report("applysizehints", "", n, reps * n, t, nalloc - a);
+  freemon(m);
+}
+
+static void
+benchstackpos(unsigned int n)
+{
+  const Arg args[] = { {.i = INC(+1)}, {.i = INC(-1)}, {.i = PREVSEL}, {.i = -1} };
+  const char *names[] = { "inc+1", "inc-1", "prevsel", "last" };
+  unsigned int i, j, reps = repsfor(n);
+  unsigned long long t;
+  unsigned long a;
+  Monitor *m = benchmon(n);
+
+  for (j = 0; j < LENGTH(args); j++) {
+    a = nalloc;
+    t = getnsec();
+    for (i = 0; i < reps; i++)
+      stackpos(&args[j]);
+    t = getnsec() - t;
+    report("stackpos", names[j], n, reps, t, nalloc - a);
+  }
+  /* the index is rebuilt on the first query after every change */
+  a = nalloc;
+  t = getnsec();
+  for (i = 0; i < reps; i++) {
+    m->gen++;
+    stackpos(&args[0]);
+  }
+  t = getnsec() - t;
+  report("stackpos", "inc+1 after change", n, reps, t, nalloc - a);
+  freemon(m);
+}
+
+static void
+benchattachtop(unsigned int n, unsigned int nmaster)
+{
+  char params[64];
+  unsigned int i, reps = repsfor(n);
+  unsigned long long t;
+  unsigned long a;
+  Client *c;
+  Monitor *m = benchmon(n);
+
+  m->nmaster = nmaster;
+  a = nalloc;
+  t = getnsec();
+  for (i = 0; i < reps; i++) {
+    c = m->clients;
+    detach(c);
+    attachtop(c);
+  }
+  t = getnsec() - t;
+  snprintf(params, sizeof params, "nmaster=%u", nmaster);
+  report("attachtop", params, n, reps, t, nalloc - a);
+  freemon(m);
+}
+
+int
+main(int argc, char *argv[])
+{
+  const unsigned int nmasters[] = { 1, 2, 8 };
+  const float mfacts[] = { 0.3, 0.55, 0.8 };
+  unsigned int i, j, k, l;
+
+  if (argc != 1)
+    die("usage: bench");
+  sw = 3840;
+  sh = 2160;
+  bh = 20;
+  for (l = 0; l < LENGTH(layouts); l++)
+    if (layouts[l].arrange)
+      for (i = 0; i < LENGTH(nclients); i++)
+        for (j = 0; j < LENGTH(nmasters); j++)
+          for (k = 0; k < LENGTH(mfacts); k++) {
+            benchlayout(&layouts[l], nclients[i], nmasters[j], mfacts[k], 1);
+            if (k == 1)
+              benchlayout(&layouts[l], nclients[i], nmasters[j], mfacts[k], 0);
+          }
+  for (i = 0; i < LENGTH(nclients); i++)
+    benchsizehints(nclients[i]);
+  for (i = 0; i < LENGTH(nclients); i++)
+    benchstackpos(nclients[i]);
+  for (i = 0; i < LENGTH(nclients); i++)
+    for (j = 0; j < LENGTH(nmasters); j++)
+      benchattachtop(nclients[i], nmasters[j]);
+  return EXIT_SUCCESS;
+}
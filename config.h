@@ -241,31 +241,36 @@ ResourcePref resources[] = {
 
 /* signal definitions */
 /* signum must be greater than 0 */
-/* trigger signals using `xsetroot -name "fsignal:<signame> [<type> <value>]"` */
+/* run them with `dwmc <signame> [<value>]...`, or with the older
+ * `xsetroot -name "fsignal:<signame> [<type> <value>]"`, where type is i, ui
+ * or f, or s for the commands that take a string. The last field is the type
+ * a dwmc argument is read as, int if it is left out, and NoArg for commands
+ * that take none, as setlayout reads a layout that cannot be sent */
 static Signal signals[] = {
     { "focusstack",     focusstack        },
-    { "setmfact",       setmfact          },
+    { "setmfact",       setmfact,         IpcArgFloat },
     { "togglebar",      togglebar         },
     { "incnmaster",     incnmaster        },
     { "togglefloating", togglefloating    },
     { "focusmon",       focusmon          },
     { "tagmon",         tagmon            },
     { "zoom",           zoom              },
-    { "view",           view              },
+    { "view",           view,             IpcArgUint },
     { "viewall",        viewall           },
     { "viewex",         viewex            },
-    { "toggleview",     view              },
+    { "toggleview",     view,             IpcArgUint },
     { "toggleviewex",   toggleviewex      },
     { "incgaps",        incgaps           },
     { "togglegaps",     togglegaps        },
     { "defaultgaps",    defaultgaps       },
-    { "tag",            tag               },
+    { "tag",            tag,              IpcArgUint },
     { "tagall",         tagall            },
     { "tagex",          tagex             },
-    { "toggletag",      tag               },
+    { "toggletag",      tag,              IpcArgUint },
     { "toggletagex",    toggletagex       },
     { "killclient",     killclient        },
-    { "setlayout",      setlayout         },
+    { "setlayout",      setlayout,        NoArg },
     { "setlayoutex",    setlayoutex       },
     { "xresources",     reloadxresources  },
+    { "status",         setblock,         IpcArgString },
 };
@@ -1,7 +1,12 @@
 /* See LICENSE file for copyright and license details. */
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <X11/Xlib.h>
 #include <X11/Xft/Xft.h>
 
@@ -10,6 +15,27 @@
 
 #define UTF_INVALID 0xFFFD
 #define UTF_SIZ     4
+#define BMP_SIZ     0x10000
+
+enum { FontUnknown, FontMissing, FontPending, FontFirst }; /* coverage entries */
+
+typedef struct Fallback {
+	long cp;
+	FcPattern *pattern;          /* to match, then the match or NULL */
+	struct Fallback *next;
+} Fallback;
+
+/* Fallback fonts are matched by a worker thread, as a cold fontconfig cache
+ * can take long enough to stall input. Matches are handed back through done
+ * and announced with a byte on fd[1]. */
+struct Resolver {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	Fallback *todo, *done;
+	int fd[2];
+	int quit;
+};
 
 static const unsigned char utfbyte[UTF_SIZ + 1] = {0x80,    0, 0xC0, 0xE0, 0xF0};
 static const unsigned char utfmask[UTF_SIZ + 1] = {0xC0, 0x80, 0xE0, 0xF0, 0xF8};
@@ -60,6 +86,207 @@ utf8decode(const char *c, long *u, size_t clen)
 	return len;
 }
 
+static void
+fallbacks_free(Fallback *f)
+{
+	Fallback *next;
+
+	for (; f; f = next) {
+		next = f->next;
+		if (f->pattern)
+			FcPatternDestroy(f->pattern);
+		free(f);
+	}
+}
+
+static void *
+resolver_run(void *arg)
+{
+	Resolver *r = arg;
+	Fallback *f;
+	FcPattern *match;
+	FcResult result;
+
+	pthread_mutex_lock(&r->lock);
+	for (;;) {
+		while (!r->todo && !r->quit)
+			pthread_cond_wait(&r->cond, &r->lock);
+		if (r->quit)
+			break;
+		f = r->todo;
+		r->todo = f->next;
+		pthread_mutex_unlock(&r->lock);
+
+		match = FcFontMatch(NULL, f->pattern, &result);
+		FcPatternDestroy(f->pattern);
+		f->pattern = match;
+
+		pthread_mutex_lock(&r->lock);
+		f->next = r->done;
+		r->done = f;
+		if (!r->quit && write(r->fd[1], "", 1) == -1)
+			; /* a byte is already waiting */
+	}
+	pthread_mutex_unlock(&r->lock);
+
+	/* let go of in resolver_free(), which does not wait for a match */
+	fallbacks_free(r->todo);
+	fallbacks_free(r->done);
+	pthread_mutex_destroy(&r->lock);
+	pthread_cond_destroy(&r->cond);
+	close(r->fd[0]);
+	close(r->fd[1]);
+	free(r);
+	return NULL;
+}
+
+/* Returns NULL if the worker cannot be started, then fallback fonts are
+ * matched in drw_text() itself */
+static Resolver *
+resolver_create(void)
+{
+	Resolver *r = ecalloc(1, sizeof(Resolver));
+
+	if (pipe(r->fd) == -1) {
+		free(r);
+		return NULL;
+	}
+	fcntl(r->fd[0], F_SETFD, FD_CLOEXEC);
+	fcntl(r->fd[1], F_SETFD, FD_CLOEXEC);
+	fcntl(r->fd[0], F_SETFL, O_NONBLOCK);
+	fcntl(r->fd[1], F_SETFL, O_NONBLOCK);
+	pthread_mutex_init(&r->lock, NULL);
+	pthread_cond_init(&r->cond, NULL);
+	if (pthread_create(&r->thread, NULL, resolver_run, r)) {
+		pthread_mutex_destroy(&r->lock);
+		pthread_cond_destroy(&r->cond);
+		close(r->fd[0]);
+		close(r->fd[1]);
+		free(r);
+		return NULL;
+	}
+	return r;
+}
+
+/* Hands r over to the worker, which frees it once the match it may be
+ * running is done, as a cold cache could hold up the caller for long. The
+ * fd of drw_fallback_fd() must no longer be watched. */
+static void
+resolver_free(Resolver *r)
+{
+	if (!r)
+		return;
+	pthread_mutex_lock(&r->lock);
+	r->quit = 1;
+	pthread_detach(r->thread);
+	pthread_cond_signal(&r->cond);
+	pthread_mutex_unlock(&r->lock);
+}
+
+static void
+resolver_push(Resolver *r, long cp, FcPattern *pattern)
+{
+	Fallback *f = ecalloc(1, sizeof(Fallback));
+
+	f->cp = cp;
+	f->pattern = pattern;
+	pthread_mutex_lock(&r->lock);
+	f->next = r->todo;
+	r->todo = f;
+	pthread_cond_signal(&r->cond);
+	pthread_mutex_unlock(&r->lock);
+}
+
+/* 64-bit FNV-1a, never 0 so that it can mark unused cache entries */
+static uint64_t
+texthash(const char *text, unsigned int *len)
+{
+	uint64_t h = 14695981039346656037ULL;
+	const char *s;
+
+	for (s = text; *s; s++)
+		h = (h ^ (unsigned char)*s) * 1099511628211ULL;
+	*len = s - text;
+	return h | !h;
+}
+
+static void
+segments_clear(Drw *drw)
+{
+	unsigned int i;
+
+	for (i = 0; i < SEGCACHE; i++)
+		if (drw->segs[i].pm)
+			XFreePixmap(drw->dpy, drw->segs[i].pm);
+	memset(drw->segs, 0, sizeof drw->segs);
+}
+
+/* Rectangles and glyphs are queued in drawing order and sent when the
+ * drawable is read back, a run of one kind and color as a single request. */
+static void
+batch_flush(Drw *drw)
+{
+	Batch *b = &drw->batch;
+	BatchOp *op;
+	unsigned long fg = 0;
+	int set = 0;
+
+	for (op = b->ops; op < b->ops + b->nops; op++) {
+		if (op->kind != BatchGlyphs && (!set || fg != op->color.pixel)) {
+			XSetForeground(drw->dpy, drw->gc, fg = op->color.pixel);
+			set = 1;
+		}
+		switch (op->kind) {
+		case BatchFill:
+			XFillRectangles(drw->dpy, drw->drawable, drw->gc, b->rects + op->start, op->n);
+			break;
+		case BatchOutline:
+			XDrawRectangles(drw->dpy, drw->drawable, drw->gc, b->rects + op->start, op->n);
+			break;
+		case BatchGlyphs:
+			XftDrawGlyphFontSpec(drw->xftdraw, &op->color, b->glyphs + op->start, op->n);
+			break;
+		}
+	}
+	b->nops = b->nrects = b->nglyphs = 0;
+}
+
+/* Returns the op to append n rectangles or glyphs of color to, flushing
+ * first if they do not fit. */
+static BatchOp *
+batch_op(Drw *drw, int kind, const XftColor *color, unsigned int n)
+{
+	Batch *b = &drw->batch;
+	BatchOp *op;
+
+	if (b->nops == BATCHOPS
+	|| (kind == BatchGlyphs ? b->nglyphs + n > BATCHGLYPHS : b->nrects + n > BATCHRECTS))
+		batch_flush(drw);
+	op = b->nops ? &b->ops[b->nops - 1] : NULL;
+	if (op && op->kind == kind && op->color.pixel == color->pixel
+	&& (kind != BatchGlyphs || !memcmp(&op->color.color, &color->color, sizeof color->color)))
+		return op;
+	op = &b->ops[b->nops++];
+	op->kind = kind;
+	op->color = *color;
+	op->start = kind == BatchGlyphs ? b->nglyphs : b->nrects;
+	op->n = 0;
+	return op;
+}
+
+static void
+batch_rect(Drw *drw, int kind, const XftColor *color, int x, int y, unsigned int w, unsigned int h)
+{
+	BatchOp *op = batch_op(drw, kind, color, 1);
+	XRectangle *r = &drw->batch.rects[drw->batch.nrects++];
+
+	r->x = x;
+	r->y = y;
+	r->width = w;
+	r->height = h;
+	op->n++;
+}
+
 Drw *
 drw_create(Display *dpy, int screen, Window root, unsigned int w, unsigned int h, Visual *visual, unsigned int depth, Colormap cmap)
 {
@@ -74,8 +301,10 @@ drw_create(Display *dpy, int screen, Window root, unsigned int w, unsigned int h
 	drw->depth = depth;
 	drw->cmap = cmap;
 	drw->drawable = XCreatePixmap(dpy, root, w, h, depth);
+	drw->xftdraw = XftDrawCreate(dpy, drw->drawable, visual, cmap);
 	drw->gc = XCreateGC(dpy, drw->drawable, 0, NULL);
 	XSetLineAttributes(dpy, drw->gc, 1, LineSolid, CapButt, JoinMiter);
+	drw->resolver = resolver_create();
 
 	return drw;
 }
@@ -86,19 +315,26 @@ drw_resize(Drw *drw, unsigned int w, unsigned int h)
 	if (!drw)
 		return;
 
+	drw->batch.nops = drw->batch.nrects = drw->batch.nglyphs = 0; /* for the old pixmap */
 	drw->w = w;
 	drw->h = h;
 	if (drw->drawable)
 		XFreePixmap(drw->dpy, drw->drawable);
 	drw->drawable = XCreatePixmap(drw->dpy, drw->root, w, h, drw->depth);
+	XftDrawChange(drw->xftdraw, drw->drawable);
 }
 
 void
 drw_free(Drw *drw)
 {
+	XftDrawDestroy(drw->xftdraw);
 	XFreePixmap(drw->dpy, drw->drawable);
 	XFreeGC(drw->dpy, drw->gc);
+	segments_clear(drw);
+	resolver_free(drw->resolver);
 	drw_fontset_free(drw->fonts);
+	free(drw->bmp);
+	free(drw->cps);
 	free(drw);
 }
 
@@ -158,6 +394,90 @@ xfont_create(Drw *drw, const char *fontname, FcPattern *fontpattern)
 	return font;
 }
 
+static Coverage *
+coverage_slot(Coverage *cps, unsigned int size, long cp)
+{
+	Coverage *e;
+
+	for (e = &cps[(cp * 2654435761u) & (size - 1)]; e->cp && e->cp != cp;)
+		e = e == &cps[size - 1] ? cps : e + 1;
+	return e;
+}
+
+/* Returns the entry recording which font covers codepoint cp. Codepoints
+ * above the BMP are never evicted, as a missing or pending entry lost to a
+ * collision would search for a fallback font again on every redraw. The
+ * entry is valid until the next call. */
+static unsigned char *
+coverage(Drw *drw, long cp)
+{
+	Coverage *e, *old;
+	unsigned int i, size;
+
+	if (cp < BMP_SIZ) {
+		if (!drw->bmp)
+			drw->bmp = ecalloc(BMP_SIZ, 1);
+		return &drw->bmp[cp];
+	}
+	if ((drw->ncps + 1) * 4 > drw->cpsize * 3) {
+		old = drw->cps;
+		size = drw->cpsize;
+		drw->cpsize = size ? size * 2 : CPCACHE;
+		drw->cps = ecalloc(drw->cpsize, sizeof(Coverage));
+		for (i = 0; i < size; i++)
+			if (old[i].cp)
+				*coverage_slot(drw->cps, drw->cpsize, old[i].cp) = old[i];
+		free(old);
+	}
+	e = coverage_slot(drw->cps, drw->cpsize, cp);
+	if (!e->cp) {
+		e->cp = cp;
+		e->font = FontUnknown;
+		drw->ncps++;
+	}
+	return &e->font;
+}
+
+static void
+coverage_clear(Drw *drw)
+{
+	if (drw->bmp)
+		memset(drw->bmp, 0, BMP_SIZ);
+	if (drw->cps)
+		memset(drw->cps, 0, drw->cpsize * sizeof(Coverage));
+	drw->ncps = 0;
+}
+
+/* Returns the first font in the set that has a glyph for cp, or NULL if none
+ * has and no fallback font was searched for it yet. Codepoints that no
+ * fallback font covers either, or whose search is still running, are drawn
+ * with the first font. Both outcomes
+ * are remembered until the font set changes; fallback fonts are appended, so
+ * the position of a font in the set stays valid. */
+static Fnt *
+xfont_for(Drw *drw, long cp)
+{
+	unsigned char *e = coverage(drw, cp);
+	Fnt *f;
+	int i;
+
+	if (*e == FontUnknown) {
+		for (f = drw->fonts, i = 0; f; f = f->next, i++)
+			if (XftCharExists(drw->dpy, f->xfont, cp))
+				break;
+		if (!f)
+			return NULL;
+		if (FontFirst + i > UCHAR_MAX)
+			return f;
+		*e = FontFirst + i;
+	}
+	if (*e == FontMissing || *e == FontPending)
+		return drw->fonts;
+	for (f = drw->fonts, i = *e - FontFirst; i--; f = f->next)
+		; /* NOP */
+	return f;
+}
+
 static void
 xfont_free(Fnt *font)
 {
@@ -169,6 +489,60 @@ xfont_free(Fnt *font)
 	free(font);
 }
 
+/* Returns the pattern to match a fallback font for cp against */
+static FcPattern *
+xfont_fallback(Drw *drw, long cp)
+{
+	FcCharSet *fccharset;
+	FcPattern *fcpattern;
+
+	if (!drw->fonts->pattern) {
+		/* Refer to the comment in xfont_create for more information. */
+		die("the first font in the cache must be loaded from a font string.");
+	}
+
+	fccharset = FcCharSetCreate();
+	FcCharSetAddChar(fccharset, cp);
+
+	fcpattern = FcPatternDuplicate(drw->fonts->pattern);
+	FcPatternAddCharSet(fcpattern, FC_CHARSET, fccharset);
+	FcPatternAddBool(fcpattern, FC_SCALABLE, FcTrue);
+	FcPatternAddBool(fcpattern, FC_COLOR, FcFalse);
+
+	FcConfigSubstitute(NULL, fcpattern, FcMatchPattern);
+	FcDefaultSubstitute(fcpattern);
+	FcCharSetDestroy(fccharset);
+	return fcpattern;
+}
+
+/* Appends the font of match to the set if it has a glyph for cp that no font
+ * in the set has, and records which font covers cp */
+static void
+xfont_append(Drw *drw, long cp, FcPattern *match)
+{
+	Fnt *f, *last;
+	int n;
+
+	*coverage(drw, cp) = FontMissing;
+	if (!match)
+		return;
+	for (f = drw->fonts; f; f = f->next)
+		if (XftCharExists(drw->dpy, f->xfont, cp)) { /* appended meanwhile */
+			FcPatternDestroy(match);
+			*coverage(drw, cp) = FontUnknown;
+			return;
+		}
+	f = xfont_create(drw, NULL, match);
+	if (!f || !XftCharExists(drw->dpy, f->xfont, cp)) {
+		xfont_free(f);
+		return;
+	}
+	for (last = drw->fonts, n = 1; last->next; last = last->next, n++)
+		; /* NOP */
+	last->next = f;
+	*coverage(drw, cp) = FontFirst + n <= UCHAR_MAX ? FontFirst + n : FontUnknown;
+}
+
 Fnt*
 drw_fontset_create(Drw* drw, char font[])
 {
@@ -181,6 +555,8 @@ drw_fontset_create(Drw* drw, char font[])
     ret = cur;
   }
 
+	memset(drw->widths, 0, sizeof drw->widths);
+	coverage_clear(drw);
 	return (drw->fonts = ret);
 }
 
@@ -225,8 +601,12 @@ drw_scm_create(Drw *drw, char *clrnames[], unsigned int alpha, size_t clrcount)
 void
 drw_setfontset(Drw *drw, Fnt *set)
 {
-	if (drw)
+	if (drw && drw->fonts != set) {
 		drw->fonts = set;
+		memset(drw->widths, 0, sizeof drw->widths);
+		coverage_clear(drw);
+		segments_clear(drw);
+	}
 }
 
 void
@@ -241,11 +621,37 @@ drw_rect(Drw *drw, int x, int y, unsigned int w, unsigned int h, int filled, int
 {
 	if (!drw || !drw->scheme)
 		return;
-	XSetForeground(drw->dpy, drw->gc, invert ? drw->scheme[ColBg].pixel : drw->scheme[ColFg].pixel);
 	if (filled)
-		XFillRectangle(drw->dpy, drw->drawable, drw->gc, x, y, w, h);
+		batch_rect(drw, BatchFill, &drw->scheme[invert ? ColBg : ColFg], x, y, w, h);
 	else
-		XDrawRectangle(drw->dpy, drw->drawable, drw->gc, x, y, w - 1, h - 1);
+		batch_rect(drw, BatchOutline, &drw->scheme[invert ? ColBg : ColFg], x, y, w - 1, h - 1);
+}
+
+/* Queues the glyphs of the len bytes of text, as XftDrawStringUtf8() would
+ * draw them. */
+static void
+batch_text(Drw *drw, const XftColor *color, XftFont *font, int x, int y, const char *text, size_t len)
+{
+	BatchOp *op = batch_op(drw, BatchGlyphs, color, len);
+	XftGlyphFontSpec *spec;
+	XGlyphInfo ext;
+	FT_UInt glyph;
+	long cp;
+	size_t i, clen;
+
+	for (i = 0; i < len; i += clen) {
+		if (!(clen = utf8decode(text + i, &cp, len - i)))
+			break;
+		glyph = XftCharIndex(drw->dpy, font, cp);
+		XftGlyphExtents(drw->dpy, font, &glyph, 1, &ext);
+		spec = &drw->batch.glyphs[drw->batch.nglyphs++];
+		spec->font = font;
+		spec->glyph = glyph;
+		spec->x = x;
+		spec->y = y;
+		x += ext.xOff;
+		op->n++;
+	}
 }
 
 int
@@ -254,17 +660,13 @@ drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned int lp
 	char buf[1024];
 	int ty;
 	unsigned int ew;
-	XftDraw *d = NULL;
 	Fnt *usedfont, *curfont, *nextfont;
 	size_t i, len;
 	int utf8strlen, utf8charlen, render = x || y || w || h;
 	long utf8codepoint = 0;
 	const char *utf8str;
-	FcCharSet *fccharset;
 	FcPattern *fcpattern;
-	FcPattern *match;
 	XftResult result;
-	int charexists = 0;
 
 	if (!drw || (render && !drw->scheme) || !text || !drw->fonts)
 		return 0;
@@ -272,9 +674,7 @@ drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned int lp
 	if (!render) {
 		w = ~w;
 	} else {
-		XSetForeground(drw->dpy, drw->gc, drw->scheme[invert ? ColFg : ColBg].pixel);
-		XFillRectangle(drw->dpy, drw->drawable, drw->gc, x, y, w, h);
-		d = XftDrawCreate(drw->dpy, drw->drawable, drw->visual, drw->cmap);
+		batch_rect(drw, BatchFill, &drw->scheme[invert ? ColFg : ColBg], x, y, w, h);
 		x += lpad;
 		w -= lpad;
 	}
@@ -286,23 +686,14 @@ drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned int lp
 		nextfont = NULL;
 		while (*text) {
 			utf8charlen = utf8decode(text, &utf8codepoint, UTF_SIZ);
-			for (curfont = drw->fonts; curfont; curfont = curfont->next) {
-				charexists = charexists || XftCharExists(drw->dpy, curfont->xfont, utf8codepoint);
-				if (charexists) {
-					if (curfont == usedfont) {
-						utf8strlen += utf8charlen;
-						text += utf8charlen;
-					} else {
-						nextfont = curfont;
-					}
-					break;
-				}
-			}
-
-			if (!charexists || nextfont)
+			if (!(curfont = xfont_for(drw, utf8codepoint)))
 				break;
-			else
-				charexists = 0;
+			if (curfont != usedfont) {
+				nextfont = curfont;
+				break;
+			}
+			utf8strlen += utf8charlen;
+			text += utf8charlen;
 		}
 
 		if (utf8strlen) {
@@ -320,8 +711,8 @@ drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned int lp
 
 				if (render) {
 					ty = y + (h - usedfont->h) / 2 + usedfont->xfont->ascent;
-					XftDrawStringUtf8(d, &drw->scheme[invert ? ColBg : ColFg],
-					                  usedfont->xfont, x, ty, (XftChar8 *)buf, len);
+					batch_text(drw, &drw->scheme[invert ? ColBg : ColFg],
+					           usedfont->xfont, x, ty, buf, len);
 				}
 				x += ew;
 				w -= ew;
@@ -331,49 +722,23 @@ drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned int lp
 		if (!*text) {
 			break;
 		} else if (nextfont) {
-			charexists = 0;
 			usedfont = nextfont;
 		} else {
 			/* Regardless of whether or not a fallback font is found, the
-			 * character must be drawn. */
-			charexists = 1;
-
-			fccharset = FcCharSetCreate();
-			FcCharSetAddChar(fccharset, utf8codepoint);
-
-			if (!drw->fonts->pattern) {
-				/* Refer to the comment in xfont_create for more information. */
-				die("the first font in the cache must be loaded from a font string.");
-			}
-
-			fcpattern = FcPatternDuplicate(drw->fonts->pattern);
-			FcPatternAddCharSet(fcpattern, FC_CHARSET, fccharset);
-			FcPatternAddBool(fcpattern, FC_SCALABLE, FcTrue);
-			FcPatternAddBool(fcpattern, FC_COLOR, FcFalse);
-
-			FcConfigSubstitute(NULL, fcpattern, FcMatchPattern);
-			FcDefaultSubstitute(fcpattern);
-			match = XftFontMatch(drw->dpy, drw->screen, fcpattern, &result);
-
-			FcCharSetDestroy(fccharset);
-			FcPatternDestroy(fcpattern);
-
-			if (match) {
-				usedfont = xfont_create(drw, NULL, match);
-				if (usedfont && XftCharExists(drw->dpy, usedfont->xfont, utf8codepoint)) {
-					for (curfont = drw->fonts; curfont->next; curfont = curfont->next)
-						; /* NOP */
-					curfont->next = usedfont;
-				} else {
-					xfont_free(usedfont);
-					usedfont = drw->fonts;
-				}
+			 * character must be drawn, xfont_for() returns a font for it
+			 * from now on: the first font while the worker looks for one. */
+			fcpattern = xfont_fallback(drw, utf8codepoint);
+			if (drw->resolver) {
+				XftDefaultSubstitute(drw->dpy, drw->screen, fcpattern);
+				resolver_push(drw->resolver, utf8codepoint, fcpattern);
+				*coverage(drw, utf8codepoint) = FontPending;
+			} else {
+				xfont_append(drw, utf8codepoint,
+				             XftFontMatch(drw->dpy, drw->screen, fcpattern, &result));
+				FcPatternDestroy(fcpattern);
 			}
 		}
 	}
-	if (d)
-		XftDrawDestroy(d);
-
 	return x + (render ? w : 0);
 }
 
@@ -383,16 +748,116 @@ drw_map(Drw *drw, Window win, int x, int y, unsigned int w, unsigned int h)
 	if (!drw)
 		return;
 
+	batch_flush(drw);
 	XCopyArea(drw->dpy, drw->drawable, win, drw->gc, x, y, w, h, x, y);
-	XSync(drw->dpy, False);
 }
 
+/* Segments are pieces of the drawable, such as a tag in one of its states,
+ * drawn once and copied back from a pixmap of their own from then on. They
+ * are keyed by the text they show and a state chosen by the caller, and
+ * dropped when the fonts change. */
+int
+drw_seg_copy(Drw *drw, const char *text, unsigned int state, int x, int y, unsigned int w, unsigned int h)
+{
+	unsigned int len;
+	uint64_t hash;
+	Segment *e;
+
+	if (!drw || !text)
+		return 0;
+	hash = texthash(text, &len) ^ state * 0x9e3779b97f4a7c15ULL;
+	e = &drw->segs[(hash ^ hash >> 32) & (SEGCACHE - 1)];
+	if (!e->pm || e->hash != hash || e->len != len || e->state != state || e->w != w || e->h != h)
+		return 0;
+	batch_flush(drw);
+	XCopyArea(drw->dpy, e->pm, drw->drawable, drw->gc, 0, 0, w, h, x, y);
+	return 1;
+}
+
+void
+drw_seg_save(Drw *drw, const char *text, unsigned int state, int x, int y, unsigned int w, unsigned int h)
+{
+	unsigned int len;
+	uint64_t hash;
+	Segment *e;
+
+	if (!drw || !text || !w || !h)
+		return;
+	hash = texthash(text, &len) ^ state * 0x9e3779b97f4a7c15ULL;
+	e = &drw->segs[(hash ^ hash >> 32) & (SEGCACHE - 1)];
+	if (e->pm && (e->w != w || e->h != h)) {
+		XFreePixmap(drw->dpy, e->pm);
+		e->pm = 0;
+	}
+	if (!e->pm)
+		e->pm = XCreatePixmap(drw->dpy, drw->root, w, h, drw->depth);
+	batch_flush(drw);
+	XCopyArea(drw->dpy, drw->drawable, e->pm, drw->gc, x, y, w, h, 0, 0);
+	e->hash = hash;
+	e->len = len;
+	e->state = state;
+	e->w = w;
+	e->h = h;
+}
+
+int
+drw_fallback_fd(Drw *drw)
+{
+	return drw && drw->resolver ? drw->resolver->fd[0] : -1;
+}
+
+/* Adds the fallback fonts the worker found to the set. Returns how many
+ * searches completed; text drawn or measured before may have changed width
+ * then, and the width cache is cleared. */
+int
+drw_fallback_load(Drw *drw)
+{
+	Resolver *r;
+	Fallback *f, *done;
+	char buf[64];
+	int n = 0;
+
+	if (!drw || !(r = drw->resolver))
+		return 0;
+	while (read(r->fd[0], buf, sizeof buf) > 0)
+		; /* NOP */
+	pthread_mutex_lock(&r->lock);
+	done = r->done;
+	r->done = NULL;
+	pthread_mutex_unlock(&r->lock);
+	for (f = done; f; f = f->next, n++) {
+		xfont_append(drw, f->cp, f->pattern);
+		f->pattern = NULL;
+	}
+	fallbacks_free(done);
+	if (n) {
+		memset(drw->widths, 0, sizeof drw->widths);
+		segments_clear(drw);
+	}
+	return n;
+}
+
+/* Widths are cached by a 64-bit FNV-1a hash and the length of the text in a
+ * direct-mapped table, so that tags, titles and status blocks drawn again
+ * are not resolved and measured glyph by glyph. The table is cleared when
+ * the fonts change. */
 unsigned int
 drw_fontset_getwidth(Drw *drw, const char *text)
 {
+	unsigned int len;
+	uint64_t h;
+	Width *e;
+
 	if (!drw || !drw->fonts || !text)
 		return 0;
-	return drw_text(drw, 0, 0, 0, 0, 0, text, 0);
+	h = texthash(text, &len);
+	e = &drw->widths[h & (WIDTHCACHE - 1)];
+	if (e->hash != h || e->len != len) {
+		e->hash = h;
+		e->len = len;
+		e->w = drw_text(drw, 0, 0, 0, 0, 0, text, 0);
+	}
+	return e->w;
 }
 
 void
@@ -12,6 +12,46 @@ typedef struct Fnt {
 	struct Fnt *next;
 } Fnt;
 
+#define WIDTHCACHE  256 /* power of two */
+#define CPCACHE     64  /* initial slots for codepoints above the BMP, power of two */
+#define SEGCACHE    128 /* power of two */
+#define BATCHOPS    64
+#define BATCHRECTS  256
+#define BATCHGLYPHS 1024 /* at least the longest run drw_text() draws at once */
+
+typedef struct {
+	uint64_t hash; /* of the text, 0 if the entry is unused */
+	unsigned int len, w;
+} Width;
+
+typedef struct {
+	uint32_t cp;       /* 0 if the entry is unused */
+	unsigned char font;
+} Coverage;
+
+typedef struct {
+	uint64_t hash;
+	unsigned int len, state, w, h;
+	Pixmap pm;      /* None if the entry is unused */
+} Segment;
+
+enum { BatchFill, BatchOutline, BatchGlyphs }; /* BatchOp kind */
+
+typedef struct {
+	int kind;
+	XftColor color;       /* only the pixel is used for rectangles */
+	unsigned int start, n; /* into rects or glyphs */
+} BatchOp;
+
+typedef struct {
+	BatchOp ops[BATCHOPS];
+	XRectangle rects[BATCHRECTS];
+	XftGlyphFontSpec glyphs[BATCHGLYPHS];
+	unsigned int nops, nrects, nglyphs;
+} Batch;
+
+typedef struct Resolver Resolver;
+
 enum { ColFg, ColBg, ColBorder }; /* Clr scheme index */
 typedef XftColor Clr;
 
@@ -24,9 +64,17 @@ typedef struct {
 	unsigned int depth;
 	Colormap cmap;
 	Drawable drawable;
+	XftDraw *xftdraw;         /* for drawable, kept across drw_text() calls */
 	GC gc;
 	Clr *scheme;
 	Fnt *fonts;
+	Width widths[WIDTHCACHE]; /* see drw_fontset_getwidth() */
+	unsigned char *bmp;       /* font of each BMP codepoint, see xfont_for() */
+	Coverage *cps;            /* and of the codepoints above it, open addressed */
+	unsigned int ncps, cpsize;
+	Resolver *resolver;       /* fallback font worker, NULL if matched in drw_text() */
+	Segment segs[SEGCACHE];   /* see drw_seg_copy() */
+	Batch batch;              /* see batch_flush() */
 } Drw;
 
 /* Drawable abstraction */
@@ -39,6 +87,8 @@ Fnt *drw_fontset_create(Drw* drw, char fonts[]);
 void drw_fontset_free(Fnt* set);
 unsigned int drw_fontset_getwidth(Drw *drw, const char *text);
 void drw_font_getexts(Fnt *font, const char *text, unsigned int len, unsigned int *w, unsigned int *h);
+int drw_fallback_fd(Drw *drw);
+int drw_fallback_load(Drw *drw);
 
 /* Colorscheme abstraction */
 void drw_clr_create(Drw *drw, Clr *dest, char *clrname, unsigned int alpha);
@@ -58,3 +108,7 @@ int drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned in
 
 /* Map functions */
 void drw_map(Drw *drw, Window win, int x, int y, unsigned int w, unsigned int h);
+
+/* Segment cache */
+int drw_seg_copy(Drw *drw, const char *text, unsigned int state, int x, int y, unsigned int w, unsigned int h);
+void drw_seg_save(Drw *drw, const char *text, unsigned int state, int x, int y, unsigned int w, unsigned int h);
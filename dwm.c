@@ -24,11 +24,19 @@
 #include <locale.h>
 #include <signal.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <sys/wait.h>
 #include <X11/cursorfont.h>
 #include <X11/keysym.h>
@@ -45,12 +53,9 @@
 #include <sys/prctl.h>
 #include <X11/Xlib-xcb.h>
 #include <xcb/res.h>
-#ifdef __OpenBSD__
-#include <sys/sysctl.h>
-#include <kvm.h>
-#endif /* __OpenBSD */
 
 #include "drw.h"
+#include "ipc.h"
 #include "util.h"
 
 /* macros */
@@ -71,11 +76,70 @@
 #define ISINC(X)                ((X) > 1000 && (X) < 3000)
 #define GETINC(X)               ((X) - 2000)
 #define MOD(N,M)                ((N)%(M) < 0 ? (N)%(M) + (M) : (N)%(M))
+#define PROPMANAGE              ((1 << PropAttributes) - 1)
+#define SLABCLIENTS             64
+#define TRACEMAGIC              "DWMT1"
+#define HISTBUCKETS             32
+#define CMDTABSIZE              64 /* power of two, at least twice LENGTH(signals) */
+#define STATUSBLOCKS            32 /* block ids are 1 to STATUSBLOCKS - 1 */
+/* the fields of each handled event kept in a trace; W are windows, A atoms
+ * and K keycodes, which are stored in a form that does not depend on the
+ * server so that replay can map them back */
+#define TRACEFIELDS(E, F, W, A, K) \
+  switch((E)->type) { \
+    case ButtonPress:      W((E)->xbutton.window) F((E)->xbutton.button) \
+                           F((E)->xbutton.state) F((E)->xbutton.x) F((E)->xbutton.y) break; \
+    case ClientMessage:    W((E)->xclient.window) A((E)->xclient.message_type) \
+                           F((E)->xclient.data.l[0]) A((E)->xclient.data.l[1]) \
+                           A((E)->xclient.data.l[2]) break; \
+    case ConfigureRequest: W((E)->xconfigurerequest.window) F((E)->xconfigurerequest.value_mask) \
+                           F((E)->xconfigurerequest.x) F((E)->xconfigurerequest.y) \
+                           F((E)->xconfigurerequest.width) F((E)->xconfigurerequest.height) \
+                           F((E)->xconfigurerequest.border_width) \
+                           W((E)->xconfigurerequest.above) F((E)->xconfigurerequest.detail) break; \
+    case ConfigureNotify:  W((E)->xconfigure.window) F((E)->xconfigure.width) \
+                           F((E)->xconfigure.height) break; \
+    case DestroyNotify:    W((E)->xdestroywindow.window) break; \
+    case EnterNotify:      W((E)->xcrossing.window) F((E)->xcrossing.mode) \
+                           F((E)->xcrossing.detail) break; \
+    case Expose:           W((E)->xexpose.window) F((E)->xexpose.count) break; \
+    case FocusIn:          W((E)->xfocus.window) break; \
+    case KeyPress:         K((E)->xkey.keycode) F((E)->xkey.state) break; \
+    case MappingNotify:    F((E)->xmapping.request) break; \
+    case MapRequest:       W((E)->xmaprequest.window) break; \
+    case MotionNotify:     W((E)->xmotion.window) F((E)->xmotion.x) F((E)->xmotion.y) \
+                           F((E)->xmotion.x_root) F((E)->xmotion.y_root) break; \
+    case PropertyNotify:   W((E)->xproperty.window) A((E)->xproperty.atom) \
+                           F((E)->xproperty.state) break; \
+    case UnmapNotify:      W((E)->xunmap.window) F((E)->xunmap.send_event) break; \
+  }
 
 #define DSBLOCKSLOCKFILE        "/tmp/dsblocks.pid"
 #define OPAQUE                  0xffU
 #define PREVSEL                 3000
 
+#ifdef XSTATS
+/* calls that wait for a reply, see xstatswait() */
+#define XGetModifierMapping(...)    (xstatswait(0), XGetModifierMapping(__VA_ARGS__))
+#define XGetWMHints(...)            (xstatswait(0), XGetWMHints(__VA_ARGS__))
+#define XGetWMProtocols(...)        (xstatswait(0), XGetWMProtocols(__VA_ARGS__))
+#define XGrabPointer(...)           (xstatswait(0), XGrabPointer(__VA_ARGS__))
+#define XInternAtom(...)            (xstatswait(0), XInternAtom(__VA_ARGS__))
+#define XQueryPointer(...)          (xstatswait(0), XQueryPointer(__VA_ARGS__))
+#define XQueryTree(...)             (xstatswait(0), XQueryTree(__VA_ARGS__))
+#define XSync(...)                  (xstatswait(0), XSync(__VA_ARGS__))
+#define XineramaIsActive(...)       (xstatswait(0), XineramaIsActive(__VA_ARGS__))
+#define XineramaQueryScreens(...)   (xstatswait(0), XineramaQueryScreens(__VA_ARGS__))
+#define xcb_get_geometry_reply(c, ck, e) \
+  (xstatswait((ck).sequence), xcb_get_geometry_reply(c, ck, e))
+#define xcb_get_property_reply(c, ck, e) \
+  (xstatswait((ck).sequence), xcb_get_property_reply(c, ck, e))
+#define xcb_get_window_attributes_reply(c, ck, e) \
+  (xstatswait((ck).sequence), xcb_get_window_attributes_reply(c, ck, e))
+#define xcb_res_query_client_ids_reply(c, ck, e) \
+  (xstatswait((ck).sequence), xcb_res_query_client_ids_reply(c, ck, e))
+#endif /* XSTATS */
+
 /* enums */
 enum { CurNormal, CurHand, CurResize, CurMove, CurLast      }; /* cursor */
 enum { SchemeNorm, SchemeSel, SchemeTitle, SchemeSuccess,
@@ -86,6 +150,17 @@ enum { NetSupported, NetWMName, NetWMState, NetWMCheck,
        NetWMWindowTypeDialog, NetClientList, NetLast        }; /* EWMH atoms */
 enum { ClkTagBar, ClkLtSymbol, ClkStatusText, ClkWinTitle,
        ClkClientWin, ClkRootWin, ClkLast                    }; /* clicks */
+enum { TimerClientList, TimerLast                           }; /* timers */
+enum { ArrangeLayout = 1 << 0, ArrangeStack = 1 << 1        }; /* pending arrange work */
+enum { BarTags = 1 << 0, BarLtSymbol = 1 << 1, BarTitle = 1 << 2,
+       BarStatus = 1 << 3, BarAll = (1 << 4) - 1, BarCheck = 1 << 4 }; /* bar damage */
+enum { SegSel = 1, SegUrg = 2, SegOcc = 4, SegFocus = 8, SegLtSymbol = 16 }; /* cached bar segment states */
+enum { PropNetWMName, PropWMName, PropClass, PropTransient,
+       PropNetWMState, PropNetWMWindowType, PropNormalHints,
+       PropHints, PropPid, PropAttributes, PropGeometry,
+       PropWMState, PropLast                                }; /* window queries */
+enum { TraceSignal, TraceWindow                             }; /* trace records besides events */
+enum { TraceCommand = LASTEvent                             };
 
 typedef union {
   int i;
@@ -104,24 +179,39 @@ typedef struct {
 
 typedef struct Monitor Monitor;
 typedef struct Client Client;
-struct Client {
+typedef struct {
   char name[256];
   float mina, maxa;
-  int x, y, w, h;
-  int oldx, oldy, oldw, oldh;
   int basew, baseh, incw, inch, maxw, maxh, minw, minh;
-  int bw, oldbw;
-  unsigned int tags;
-  int isfixed, isfloating, isurgent, neverfocus, oldstate, isfullscreen, isterminal, noswallow, issticky;
-  int fakefullscreen;
+  int isterminal, noswallow;
   pid_t pid;
+  Client *swallowing;
+} ClientCold;           /* what layouts and visibility checks never read */
+
+struct Client {         /* what they do, in the first 64 bytes */
   Client *next;
   Client *snext;
-  Client *swallowing;
   Monitor *mon;
+  unsigned int tags;
+  char isfloating, issticky, isfullscreen, fakefullscreen;
+  char isfixed, isurgent, neverfocus, oldstate;
+  char isattached;      /* in mon->clients and counted in its tag masks */
+  char ishidden;        /* moved off screen, see showhide() */
+  int x, y, w, h, bw;
+  unsigned int vispos;  /* index in mon->vis, see visclients() */
+  Client *prev, *sprev;
   Window win;
+  ClientCold *cold;
+  int oldx, oldy, oldw, oldh, oldbw;
 };
 
+typedef struct Slab Slab;
+struct Slab {
+  Client c[SLABCLIENTS];
+  ClientCold cold[SLABCLIENTS];
+  Slab *next;
+};                      /* see allocclient() */
+
 typedef struct {
   unsigned int mod;
   KeySym keysym;
@@ -132,12 +222,65 @@ typedef struct {
 typedef struct {
   const char * sig;
   void (*func)(const Arg *);
+  int argtype; /* IpcArgString if func reads a string from arg->v, NoArg if
+                  it takes no argument or another pointer, numeric otherwise */
 } Signal;
 
+enum { NoArg = -1 }; /* Signal argtype */
+
+typedef struct {
+  unsigned long n;
+  unsigned long long sum, max;        /* ns */
+  unsigned int bucket[HISTBUCKETS];   /* by log2 of ns */
+#ifdef XSTATS
+  unsigned long requests, roundtrips;
+#endif /* XSTATS */
+} Hist;
+
+typedef struct {
+  unsigned long long t;
+#ifdef XSTATS
+  unsigned long requests, roundtrips;
+#endif /* XSTATS */
+} Stamp;
+
+typedef struct {
+  int fd;
+  void (*func)(int fd);
+} Fd;
+
+typedef struct {
+  unsigned int pending;       /* replies not collected yet, 1 << Prop* */
+  unsigned int seq[PropLast]; /* sequence numbers of the requests */
+} Props;                      /* see requestprops() */
+
+typedef struct {
+  Window win;                 /* None if the slot was never used */
+  Client *c;                  /* NULL if the slot was freed */
+} WinSlot;                    /* see findwin() */
+
+typedef struct {
+  int x, y, w, h, bw;
+} Geom;
+
+typedef struct {
+  char *text;           /* with the color codes of the root name, NULL if unset */
+  int w;                /* width of text without them */
+} Block;                /* status block, see setblock() */
+
 typedef struct {
   const char *symbol;
-  void (*arrange)(Monitor *);
-} Layout;
+  void (*arrange)(Monitor *m, Client **c, Geom *g, unsigned int n);
+} Layout;               /* arrange fills g[i] for the n tiled c[i] */
+
+typedef struct {
+  unsigned int dirty;   /* damaged regions, BarCheck to compare the state below */
+  int isselmon, ww;
+  int tx, sx;           /* title and status x */
+  unsigned int occ, urg, tagset, seltags, titleflags;
+  char ltsymbol[16];
+  char title[256];
+} Bar;                  /* what the bar currently shows, see renderbar() */
 
 typedef struct Pertag Pertag;
 struct Monitor {
@@ -152,13 +295,24 @@ struct Monitor {
   unsigned int seltags;
   unsigned int sellt;
   unsigned int tagset[2];
+  unsigned int needarrange; /* see runpending() */
   int showbar;
   int topbar;
   Client *clients;
   Client *sel;
   Client *stack;
+  unsigned int nclients;
+  unsigned int occ, urg; /* tags with clients and with urgent clients */
+  unsigned int nsticky;
+  unsigned int ntagged[31], nurgent[31]; /* per tag, see NumTags */
+  unsigned int gen;     /* bumped when a client comes, goes or is retagged */
+  Client **vis;         /* visible clients in list order, see visclients() */
+  unsigned int nvis, vissize, visgen, vistags;
+  Window *stacked;      /* tiled windows last stacked below barwin, see restack() */
+  unsigned int nstacked, stackedsize;
   Monitor *next;
   Window barwin;
+  Bar bar;
   const Layout *lt[2];
   Pertag *pertag;
 };
@@ -188,88 +342,131 @@ typedef struct {
 } ResourcePref;
 
 /* function declarations */
-static void applyrules(Client *c);
+static void addfd(int fd, void (*func)(int fd));
+static Client *allocclient(void);
+static void applyrules(Client *c, Props *p);
 static int applysizehints(Client *c, int *x, int *y, int *w, int *h, int *bw, int interact);
 static void arrange(Monitor *m);
 static void arrangemon(Monitor *m);
+static void armtimers(void);
 static void attach(Client *c);
+static void attachafter(Client *c, Client *at);
 static void attachtop(Client *c);
 static void attachstack(Client *c);
-static int fake_signal(void);
+static int fake_signal(const char *text);
 static void buttonpress(XEvent *e);
-static void centeredmaster(Monitor *m);
+static void centeredmaster(Monitor *m, Client **c, Geom *g, unsigned int n);
 static void checkotherwm(void);
 static void cleanup(void);
 static void cleanupmon(Monitor *mon);
 static void clientmessage(XEvent *e);
+static void coalesce(XEvent *q, int n);
 static void configure(Client *c);
+static void counttags(Client *c, int d);
 static void configurenotify(XEvent *e);
 static void configurerequest(XEvent *e);
 static Monitor *createmon(void);
+static void delfd(int fd);
 static void destroynotify(XEvent *e);
 static void detach(Client *c);
 static void detachstack(Client *c);
+static void discardprops(Props *p);
 static Monitor *dirtomon(int dir);
 static void drawbar(Monitor *m);
 static void drawbars(void);
 static void enternotify(XEvent *e);
+static Window evwin(XEvent *e);
 static void expose(XEvent *e);
 static Client *findbefore(Client *c);
+static WinSlot *findwin(Window w);
 static void focus(Client *c);
+static void freeclient(Client *c);
 static void focusin(XEvent *e);
+static void fontsready(int fd);
 static void focusmon(const Arg *arg);
 static void focusstack(const Arg *arg);
-static Atom getatomprop(Client *c, Atom prop);
+static Atom getatomprop(Props *p, int prop);
+static int getattributes(Props *p, XWindowAttributes *wa);
 static int getrootptr(int *x, int *y);
-static long getstate(Window w);
+static unsigned long long getnsec(void);
+static long getstate(Props *p);
 static int gettextprop(Window w, Atom atom, char *text, unsigned int size);
+static int gettextreply(xcb_get_property_reply_t *r, char *text, unsigned int size);
+static Window gettransient(Window w, Props *p);
 static void grabbuttons(Client *c, int focused);
 static void grabkeys(void);
+static void histadd(Hist *h, unsigned long long ns);
+static void histbegin(Stamp *s);
+static void histdump(void);
+static void histend(Hist *h, const Stamp *s);
+static void histprint(const char *name, const Hist *h);
+static int hasvisible(Monitor *m);
+static void hashwin(Window w, Client *c);
 static unsigned int monhasgaps(Monitor *m);
 static void incnmaster(const Arg *arg);
 static void incgaps(const Arg *arg);
+static void ipcaccept(int fd);
+static unsigned int ipchash(const char *name, size_t len);
+static int ipclookup(const char *name, size_t len);
+static void ipcread(int fd);
+static int ipcparse(const char *name, size_t len, const char *text, Arg *arg);
+static int ipcrun(const char *name, size_t len, int argtype, const Arg *arg);
+static void ipcsetup(void);
 static void setnmaster(const Arg *arg);
 static void keypress(XEvent *e);
 static void killclient(const Arg *arg);
 static void loadfonts();
-static void manage(Window w, XWindowAttributes *wa);
+static void manage(Window w, XWindowAttributes *wa, Props *p);
+static void markurgent(Client *c, int urg);
 static void mappingnotify(XEvent *e);
 static void maprequest(XEvent *e);
 static void motionnotify(XEvent *e);
 static void movemouse(const Arg *arg);
 static Client *nexttiled(Client *c);
 static void propertynotify(XEvent *e);
+static xcb_get_property_reply_t *propreply(Props *p, int prop);
 static void pushstack(const Arg *arg);
 static Monitor *recttomon(int x, int y, int w, int h);
+static void renderbar(Monitor *m);
+static void requestprops(Window w, unsigned int mask, Props *p);
 static void resize(Client *c, int x, int y, int w, int h, int bw, int interact);
 static void resizeclient(Client *c, int x, int y, int w, int h, int bw);
 static void resizemouse(const Arg *arg);
 static void restack(Monitor *m);
 static void run(void);
+static void runpending(void);
+static void runsignal(int i, const Arg *arg);
 static void scan(void);
 static int sendevent(Client *c, Atom proto);
 static void sendmon(Client *c, Monitor *m);
+static void setblock(const Arg *arg);
 static void setclientstate(Client *c, long state);
 static void setfocus(Client *c);
 static void setfullscreen(Client *c, int fullscreen);
 static void setgaps(int oh, int ov, int ih, int iv);
+static void setgeom(Client *c, Geom *g, int x, int y, int w, int h, int bw);
 static void setlayout(const Arg *arg);
 static void setlayoutex(const Arg *arg);
 static void setmfact(const Arg *arg);
+static void setstatus(const char *text);
 static void setup(void);
 static void seturgent(Client *c, int urg);
 static void defaultgaps(const Arg *arg);
 static void showhide(Client *c);
-static void sigchld(int unused);
+static void settags(Client *c, unsigned int newtags);
+static void settimer(int timer, unsigned int ms);
+static void signalevent(int fd);
 static void sigdsblocks(const Arg *arg);
 static void spawn(const Arg *arg);
 static int stackpos(const Arg *arg);
 static void startdsblocks(void);
+static int statustext(int x, char *text, int draw);
 static void tag(const Arg *arg);
 static void tagall(const Arg *arg);
 static void tagex(const Arg *arg);
 static void tagmon(const Arg *arg);
-static void tile(Monitor *);
+static void tile(Monitor *m, Client **c, Geom *g, unsigned int n);
+static void timerevent(int fd);
 static void togglebar(const Arg *arg);
 static void togglefakefullscreen(const Arg *arg);
 static void togglefloating(const Arg *arg);
@@ -280,7 +477,15 @@ static void toggletagex(const Arg *arg);
 static void toggleview(const Arg *arg);
 static void toggleviewex(const Arg *arg);
 static void togglesticky(const Arg *arg);
+static long traceatom(Atom a);
+static void traceevent(XEvent *e);
+static void traceput(long v);
+static void tracerecord(int type);
+static void tracescan(void);
+static void tracesignal(const char *cmd);
+static long tracewin(Window w);
 static void unfocus(Client *c, int setfocus, Client *nextfocus);
+static void unhashwin(Window w);
 static void unmanage(Client *c, int destroyed);
 static void unmapnotify(XEvent *e);
 static void updatebarpos(Monitor *m);
@@ -289,12 +494,13 @@ static void updateclientlist(void);
 static void updatedsblockssig(int x);
 static int updategeom(void);
 static void updatenumlockmask(void);
-static void updatesizehints(Client *c);
+static void updatesizehints(Client *c, Props *p);
 static void updatestatus(void);
-static void updatetitle(Client *c);
-static void updatewindowtype(Client *c);
-static void updatewmhints(Client *c);
+static void updatetitle(Client *c, Props *p);
+static void updatewindowtype(Client *c, Props *p);
+static void updatewmhints(Client *c, Props *p);
 static void view(const Arg *arg);
+static unsigned int visclients(Monitor *m);
 static void viewall(const Arg *arg);
 static void viewex(const Arg *arg);
 static void warp(const Client *c);
@@ -303,7 +509,11 @@ static Monitor *wintomon(Window w);
 static int xerror(Display *dpy, XErrorEvent *ee);
 static int xerrordummy(Display *dpy, XErrorEvent *ee);
 static int xerrorstart(Display *dpy, XErrorEvent *ee);
+static void xevents(int fd);
 static void xinitvisual();
+#ifdef XSTATS
+static void xstatswait(unsigned int seq);
+#endif /* XSTATS */
 static void zoom(const Arg *arg);
 static void loadxresources(void);
 static void reloadxresources(const Arg *arg);
@@ -313,7 +523,7 @@ static pid_t getparentprocess(pid_t p);
 static int isdescprocess(pid_t p, pid_t c);
 static Client *swallowingclient(Window w);
 static Client *termforwin(const Client *c);
-static pid_t winpid(Window w);
+static pid_t winpid(Props *p);
 
 /* variables */
 static Client *prevzoom = NULL;
@@ -321,6 +531,9 @@ static const char broken[] = "broken";
 static char stextc[256];
 static char stexts[256];
 static int wstext;
+static Block blocks[STATUSBLOCKS];
+static int blockmode;               /* set by the first block, the root name is no longer shown */
+static unsigned int blockdirty;     /* blocks to redraw, all of them if ~0 */
 static int statushandcursor;
 static unsigned int dsblockssig;
 static int screen;
@@ -347,8 +560,49 @@ static void (*handler[LASTEvent]) (XEvent *) = {
   [PropertyNotify] = propertynotify,
   [UnmapNotify] = unmapnotify
 };
+static const char *evname[LASTEvent] = {
+  [ButtonPress] = "ButtonPress",
+  [ClientMessage] = "ClientMessage",
+  [ConfigureRequest] = "ConfigureRequest",
+  [ConfigureNotify] = "ConfigureNotify",
+  [DestroyNotify] = "DestroyNotify",
+  [EnterNotify] = "EnterNotify",
+  [Expose] = "Expose",
+  [FocusIn] = "FocusIn",
+  [KeyPress] = "KeyPress",
+  [MappingNotify] = "MappingNotify",
+  [MapRequest] = "MapRequest",
+  [MotionNotify] = "MotionNotify",
+  [PropertyNotify] = "PropertyNotify",
+  [UnmapNotify] = "UnmapNotify"
+};
+static Hist evhist[LASTEvent], pendinghist, scanhist; /* handler latencies, see histdump() */
+#ifdef XSTATS
+static unsigned long roundtrips;
+static unsigned int syncseq; /* last request known to be answered */
+#endif /* XSTATS */
+static XEvent evq[256]; /* events of one dispatch round, see coalesce() */
+static WinSlot *wintab;
+static Client **tiled;       /* arrangemon() buffers */
+static Geom *geoms;
+static unsigned int tiledsize;
+static Slab *slabs;
+static Client *freeclients; /* linked through next */
+static unsigned int wintabbits, wintabused, wintablive; /* used counts freed slots too */
 static Atom wmatom[WMLast], netatom[NetLast];
 static int running = 1;
+static int scanning;         /* in scan(), which focuses once at the end */
+static FILE *trace;          /* -t, see traceevent() */
+static unsigned long long tracet;
+static int epfd, sigfd, tmrfd;
+static Fd fds[16];           /* IPC connections beyond these are turned away */
+static int ipcfd = -1;
+static char ipcpath[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static sigset_t sigmask;
+static unsigned long long timers[TimerLast]; /* absolute deadlines in ns, 0 if unset */
+static void (*timerfunc[TimerLast]) (void) = {
+  [TimerClientList] = updateclientlist
+};
 static Cur *cursor[CurLast];
 static Clr **scheme;
 static Display *dpy;
@@ -375,34 +629,99 @@ struct Pertag {
 	int showbars[LENGTH(tags) + 1]; /* display bar for the current tag */
 };
 
+static Hist keyhist[LENGTH(keys)], sighist[LENGTH(signals)];
+static int cmdtab[CMDTABSIZE]; /* index into signals[] plus one, see ipclookup() */
+static int tagw[LENGTH(tags)], tagsw; /* measured in loadfonts() */
+
 /* compile-time check if all tags fit into an unsigned int bit array. */
 struct NumTags { char limitexceeded[LENGTH(tags) > 31 ? -1 : 1]; };
+struct NumCmds { char limitexceeded[LENGTH(signals) * 2 > CMDTABSIZE ? -1 : 1]; };
 
 /* function implementations */
 void
-applyrules(Client *c)
+addfd(int fd, void (*func)(int fd))
+{
+  unsigned int i;
+  struct epoll_event ev = { .events = EPOLLIN };
+
+  for (i = 0; i < LENGTH(fds) && fds[i].func; i++);
+  if (i == LENGTH(fds))
+    die("dwm: too many file descriptors");
+  fds[i].fd = fd;
+  fds[i].func = func;
+  ev.data.ptr = &fds[i];
+  if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == -1)
+    die("epoll_ctl:");
+}
+
+/* Clients live in slabs holding the hot structs apart from the cold ones, so
+ * that walking the lists touches as few cache lines as possible. */
+Client *
+allocclient(void)
+{
+  unsigned int i;
+  Slab *s;
+  Client *c;
+  ClientCold *cold;
+
+  if (!freeclients) {
+    s = ecalloc(1, sizeof(Slab));
+    s->next = slabs;
+    slabs = s;
+    for (i = 0; i < SLABCLIENTS; i++) {
+      s->c[i].next = freeclients;
+      s->c[i].cold = &s->cold[i];
+      freeclients = &s->c[i];
+    }
+  }
+  c = freeclients;
+  freeclients = c->next;
+  cold = c->cold;
+  memset(c, 0, sizeof(Client));
+  memset(cold, 0, sizeof(ClientCold));
+  c->cold = cold;
+  return c;
+}
+
+void
+freeclient(Client *c)
 {
-  const char *class, *instance;
+  c->next = freeclients;
+  freeclients = c;
+}
+
+void
+applyrules(Client *c, Props *p)
+{
+  const char *class = broken, *instance = broken;
+  char ch[1025];
+  int len;
   unsigned int i;
   const Rule *r;
   Monitor *m;
-  XClassHint ch = { NULL, NULL };
+  xcb_get_property_reply_t *reply;
 
   /* rule matching */
   c->isfloating = 0;
   c->tags = 0;
-  XGetClassHint(dpy, c->win, &ch);
-  class    = ch.res_class ? ch.res_class : broken;
-  instance = ch.res_name  ? ch.res_name  : broken;
+  if ((reply = propreply(p, PropClass)) && reply->type == XA_STRING && reply->format == 8) {
+    /* WM_CLASS is the instance and the class, each NUL terminated */
+    len = MIN(xcb_get_property_value_length(reply), (int)sizeof ch - 1);
+    memcpy(ch, xcb_get_property_value(reply), len);
+    ch[len] = '\0';
+    instance = ch;
+    class = ch + MIN((int)strlen(ch) + 1, len);
+  }
+  free(reply);
 
   for (i = 0; i < LENGTH(rules); i++) {
     r = &rules[i];
-    if ((!r->title || strstr(c->name, r->title))
+    if ((!r->title || strstr(c->cold->name, r->title))
         && (!r->class || strstr(class, r->class))
         && (!r->instance || strstr(instance, r->instance)))
     {
-      c->isterminal = r->isterminal;
-      c->noswallow  = r->noswallow;
+      c->cold->isterminal = r->isterminal;
+      c->cold->noswallow  = r->noswallow;
       c->isfloating = r->isfloating;
       c->tags |= r->tags;
       for (m = mons; m && m->num != r->monitor; m = m->next);
@@ -410,10 +729,6 @@ applyrules(Client *c)
         c->mon = m;
     }
   }
-  if (ch.res_class)
-    XFree(ch.res_class);
-  if (ch.res_name)
-    XFree(ch.res_name);
   c->tags = c->tags & TAGMASK ? c->tags & TAGMASK : c->mon->tagset[c->mon->seltags];
 }
 
@@ -451,61 +766,78 @@ applysizehints(Client *c, int *x, int *y, int *w, int *h, int *bw, int interact)
     *w = bh;
   if (resizehints || c->isfloating || !c->mon->lt[c->mon->sellt]->arrange) {
     /* see last two sentences in ICCCM 4.1.2.3 */
-    baseismin = c->basew == c->minw && c->baseh == c->minh;
+    baseismin = c->cold->basew == c->cold->minw && c->cold->baseh == c->cold->minh;
     if (!baseismin) { /* temporarily remove base dimensions */
-      *w -= c->basew;
-      *h -= c->baseh;
+      *w -= c->cold->basew;
+      *h -= c->cold->baseh;
     }
     /* adjust for aspect limits */
-    if (c->mina > 0 && c->maxa > 0) {
-      if (c->maxa < (float)*w / *h)
-        *w = *h * c->maxa + 0.5;
-      else if (c->mina < (float)*h / *w)
-        *h = *w * c->mina + 0.5;
+    if (c->cold->mina > 0 && c->cold->maxa > 0) {
+      if (c->cold->maxa < (float)*w / *h)
+        *w = *h * c->cold->maxa + 0.5;
+      else if (c->cold->mina < (float)*h / *w)
+        *h = *w * c->cold->mina + 0.5;
     }
     if (baseismin) { /* increment calculation requires this */
-      *w -= c->basew;
-      *h -= c->baseh;
+      *w -= c->cold->basew;
+      *h -= c->cold->baseh;
     }
     /* adjust for increment value */
-    if (c->incw)
-      *w -= *w % c->incw;
-    if (c->inch)
-      *h -= *h % c->inch;
+    if (c->cold->incw)
+      *w -= *w % c->cold->incw;
+    if (c->cold->inch)
+      *h -= *h % c->cold->inch;
     /* restore base dimensions */
-    *w = MAX(*w + c->basew, c->minw);
-    *h = MAX(*h + c->baseh, c->minh);
-    if (c->maxw)
-      *w = MIN(*w, c->maxw);
-    if (c->maxh)
-      *h = MIN(*h, c->maxh);
+    *w = MAX(*w + c->cold->basew, c->cold->minw);
+    *h = MAX(*h + c->cold->baseh, c->cold->minh);
+    if (c->cold->maxw)
+      *w = MIN(*w, c->cold->maxw);
+    if (c->cold->maxh)
+      *h = MIN(*h, c->cold->maxh);
   }
   return *x != c->x || *y != c->y || *w != c->w || *h != c->h || *bw != c->bw;
 }
 
+/* Only marks the monitor, or all monitors if m is NULL; the layout is applied
+ * once the event queue is drained, see runpending(). */
 void
 arrange(Monitor *m)
 {
   if (m)
-    showhide(m->stack);
+    m->needarrange |= ArrangeLayout|ArrangeStack;
   else for (m = mons; m; m = m->next)
-    showhide(m->stack);
-  if (m) {
-    arrangemon(m);
-    restack(m);
-  } else for (m = mons; m; m = m->next)
-    arrangemon(m);
+    m->needarrange |= ArrangeLayout;
 }
 
 void
 arrangemon(Monitor *m)
 {
+  unsigned int i, n, nvis;
   Client *c;
+  Geom *g;
 
   strncpy(m->ltsymbol, m->lt[m->sellt]->symbol, sizeof m->ltsymbol);
-  if (m->lt[m->sellt]->arrange)
-    m->lt[m->sellt]->arrange(m);
-  else
+  if (m->lt[m->sellt]->arrange) {
+    if (m->nclients > tiledsize) {
+      free(tiled);
+      free(geoms);
+      tiled = ecalloc(tiledsize = m->nclients, sizeof(Client *));
+      geoms = ecalloc(tiledsize, sizeof(Geom));
+    }
+    for (n = i = 0, nvis = visclients(m); i < nvis; i++)
+      if (!m->vis[i]->isfloating)
+        tiled[n++] = m->vis[i];
+    if (n == 0)
+      return;
+    /* layouts only compute, configure just the windows that move */
+    m->lt[m->sellt]->arrange(m, tiled, geoms, n);
+    for (i = 0; i < n; i++) {
+      c = tiled[i];
+      g = &geoms[i];
+      if (g->x != c->x || g->y != c->y || g->w != c->w || g->h != c->h || g->bw != c->bw)
+        resizeclient(c, g->x, g->y, g->w, g->h, g->bw);
+    }
+  } else
     /* <>< case; rather than providing an arrange function and upsetting other logic that tests for its presence, simply add borders here */
     for (c = selmon->clients; c; c = c->next)
       if (ISVISIBLE(c) && c->bw == 0)
@@ -515,8 +847,24 @@ arrangemon(Monitor *m)
 void
 attach(Client *c)
 {
-  c->next = c->mon->clients;
-  c->mon->clients = c;
+  attachafter(c, NULL);
+}
+
+void
+attachafter(Client *c, Client *at)
+{
+  c->prev = at;
+  c->next = at ? at->next : c->mon->clients;
+  if (c->next)
+    c->next->prev = c;
+  if (at)
+    at->next = c;
+  else
+    c->mon->clients = c;
+  c->mon->nclients++;
+  c->mon->gen++;
+  c->isattached = 1;
+  counttags(c, 1);
 }
 
 void
@@ -529,48 +877,41 @@ attachtop(Client *c)
   for (n = 1, below = c->mon->clients;
       below && below->next && (below->isfloating || !ISVISIBLEONTAG(below, c->tags) || n != m->nmaster);
       n = below->isfloating || !ISVISIBLEONTAG(below, c->tags) ? n + 0 : n + 1, below = below->next);
-  c->next = NULL;
-  if (below) {
-    c->next = below->next;
-    below->next = c;
-  }
-  else
-    c->mon->clients = c;
+  attachafter(c, below);
 }
 
 void
 attachstack(Client *c)
 {
+  c->sprev = NULL;
   c->snext = c->mon->stack;
+  if (c->snext)
+    c->snext->sprev = c;
   c->mon->stack = c;
 }
 
 int
 stackpos(const Arg *arg) {
-	int n, i;
-	Client *c, *l;
+	int n;
+	Client *l;
 
 	if(!selmon->clients)
 		return -1;
+	n = visclients(selmon);
 
 	if(arg->i == PREVSEL) {
 		for(l = selmon->stack; l && (!ISVISIBLE(l) || l == selmon->sel); l = l->snext);
 		if(!l)
 			return -1;
-		for(i = 0, c = selmon->clients; c != l; i += ISVISIBLE(c) ? 1 : 0, c = c->next);
-		return i;
+		return l->vispos;
 	}
 	else if(ISINC(arg->i)) {
 		if(!selmon->sel)
 			return -1;
-		for(i = 0, c = selmon->clients; c != selmon->sel; i += ISVISIBLE(c) ? 1 : 0, c = c->next);
-		for(n = i; c; n += ISVISIBLE(c) ? 1 : 0, c = c->next);
-		return MOD(i + GETINC(arg->i), n);
-	}
-	else if(arg->i < 0) {
-		for(i = 0, c = selmon->clients; c; i += ISVISIBLE(c) ? 1 : 0, c = c->next);
-		return MAX(i + arg->i, 0);
+		return MOD((int)selmon->sel->vispos + GETINC(arg->i), n);
 	}
+	else if(arg->i < 0)
+		return MAX(n + arg->i, 0);
 	else
 		return arg->i;
 }
@@ -578,7 +919,7 @@ stackpos(const Arg *arg) {
 void
 pushstack(const Arg *arg) {
 	int i = stackpos(arg);
-	Client *sel = selmon->sel, *c, *p;
+	Client *sel = selmon->sel, *c;
 
 	if(i < 0)
 		return;
@@ -587,13 +928,16 @@ pushstack(const Arg *arg) {
 		attach(sel);
 	}
 	else {
-		for(p = NULL, c = selmon->clients; c; p = c, c = c->next)
-			if(!(i -= (ISVISIBLE(c) && c != sel)))
-				break;
-		c = c ? c : p;
+		/* the i-th visible client other than sel, or the last one */
+		i += (unsigned int)i > sel->vispos;
+		if((unsigned int)i <= selmon->nvis)
+			c = selmon->vis[i - 1];
+		else
+			for(c = selmon->vis[selmon->nvis - 1]; c->next; c = c->next);
+		if(c == sel)
+			c = sel->prev;
 		detach(sel);
-		sel->next = c->next;
-		c->next = sel;
+		attachafter(sel, c);
 	}
 	arrange(selmon);
 }
@@ -613,9 +957,9 @@ void
 swallow(Client *p, Client *c)
 {
 
-  if (c->noswallow || c->isterminal)
+  if (c->cold->noswallow || c->cold->isterminal)
     return;
-  if (c->noswallow && !swallowfloating && c->isfloating)
+  if (c->cold->noswallow && !swallowfloating && c->isfloating)
     return;
 
   detach(c);
@@ -624,33 +968,38 @@ swallow(Client *p, Client *c)
   setclientstate(c, WithdrawnState);
   XUnmapWindow(dpy, p->win);
 
-  p->swallowing = c;
+  p->cold->swallowing = c;
   c->mon = p->mon;
 
   Window w = p->win;
   p->win = c->win;
   c->win = w;
-  updatetitle(p);
+  hashwin(p->win, p);
+  updatetitle(p, NULL);
   XMoveResizeWindow(dpy, p->win, p->x, p->y, p->w, p->h);
+  p->ishidden = 0;
+  p->mon->nstacked = 0; /* the window in its place is stacked elsewhere */
   arrange(p->mon);
   configure(p);
-  updateclientlist();
+  settimer(TimerClientList, 0);
 }
 
 void
 unswallow(Client *c)
 {
-  c->win = c->swallowing->win;
+  unhashwin(c->win);
+  c->win = c->cold->swallowing->win;
 
-  free(c->swallowing);
-  c->swallowing = NULL;
+  freeclient(c->cold->swallowing);
+  c->cold->swallowing = NULL;
 
   /* unfullscreen the client */
   setfullscreen(c, 0);
-  updatetitle(c);
-  arrange(c->mon);
+  updatetitle(c, NULL);
   XMapWindow(dpy, c->win);
   XMoveResizeWindow(dpy, c->win, c->x, c->y, c->w, c->h);
+  c->ishidden = 0;
+  c->mon->nstacked = 0;
   setclientstate(c, NormalState);
   focus(NULL);
   arrange(c->mon);
@@ -678,7 +1027,7 @@ buttonpress(XEvent *e)
       if (ev->x < ble - blw) {
         i = -1, x = -ev->x;
         do
-          x += TEXTW(tags[++i]);
+          x += tagw[++i];
         while (x <= 0);
           click = ClkTagBar;
           arg.ui = 1 << i;
@@ -727,6 +1076,7 @@ cleanup(void)
   size_t i;
 
   view(&a);
+  runpending(); /* show all clients before they are released */
   selmon->lt[selmon->sellt] = &foo;
   for (m = mons; m; m = m->next)
     while (m->stack)
@@ -740,6 +1090,24 @@ cleanup(void)
     free(scheme[i]);
   XDestroyWindow(dpy, wmcheckwin);
   drw_free(drw);
+  free(wintab);
+  free(tiled);
+  free(geoms);
+  for (i = 0; i < LENGTH(blocks); i++)
+    free(blocks[i].text);
+  while (slabs) {
+    Slab *s = slabs->next;
+    free(slabs);
+    slabs = s;
+  }
+  updateclientlist();
+  if (ipcfd != -1) {
+    close(ipcfd);
+    unlink(ipcpath);
+  }
+  close(tmrfd);
+  close(sigfd);
+  close(epfd);
   XSync(dpy, False);
   XSetInputFocus(dpy, PointerRoot, RevertToPointerRoot, CurrentTime);
   XDeleteProperty(dpy, root, netatom[NetActiveWindow]);
@@ -758,6 +1126,9 @@ cleanupmon(Monitor *mon)
   }
   XUnmapWindow(dpy, mon->barwin);
   XDestroyWindow(dpy, mon->barwin);
+  free(mon->vis);
+  free(mon->stacked);
+  free(mon->pertag);
   free(mon);
 }
 
@@ -791,6 +1162,48 @@ clientmessage(XEvent *e)
   }
 }
 
+/* Fold the last queued event into an earlier one that it supersedes. Folded
+ * events get type 0, which has no handler. Any other event on the same window
+ * stops the search, so events are never reordered across it. */
+void
+coalesce(XEvent *q, int n)
+{
+  XEvent *e = &q[n], *p;
+  Window w;
+
+  if (e->type == Expose) {
+    if (e->xexpose.count > 0)
+      e->type = 0; /* expose() only acts on the last one */
+    return;
+  }
+  if (e->type != PropertyNotify && e->type != ConfigureRequest && e->type != MotionNotify)
+    return;
+  w = evwin(e);
+  while (n--) {
+    p = &q[n];
+    if (!p->type || evwin(p) != w)
+      continue;
+    if (p->type != e->type)
+      return;
+    switch(e->type) {
+      case PropertyNotify:
+        if (p->xproperty.atom != e->xproperty.atom)
+          continue;
+        if (p->xproperty.state == e->xproperty.state)
+          p->type = 0;
+        return;
+      case ConfigureRequest:
+        /* latest wins only if it carries every field of the earlier one */
+        if ((p->xconfigurerequest.value_mask & ~e->xconfigurerequest.value_mask) == 0)
+          p->type = 0;
+        return;
+      case MotionNotify:
+        p->type = 0;
+        return;
+    }
+  }
+}
+
 void
 configure(Client *c)
 {
@@ -873,8 +1286,10 @@ configurerequest(XEvent *e)
         c->y = m->my + (m->mh / 2 - HEIGHT(c) / 2); /* center in y direction */
       if ((ev->value_mask & (CWX|CWY)) && !(ev->value_mask & (CWWidth|CWHeight)))
         configure(c);
-      if (ISVISIBLE(c))
+      if (ISVISIBLE(c)) {
         XMoveResizeWindow(dpy, c->win, c->x, c->y, c->w, c->h);
+        c->ishidden = 0;
+      }
     } else
       configure(c);
   } else {
@@ -886,8 +1301,35 @@ configurerequest(XEvent *e)
     wc.sibling = ev->above;
     wc.stack_mode = ev->detail;
     XConfigureWindow(dpy, ev->window, ev->value_mask, &wc);
+    if (ev->value_mask & CWStackMode) /* it may land between tiled windows */
+      for (m = mons; m; m = m->next)
+        m->nstacked = 0;
   }
-  XSync(dpy, False);
+}
+
+/* Adds (d = 1) or removes (d = -1) c from the per tag counts of its monitor,
+ * around every change of its tags, urgency or stickiness while attached. */
+void
+counttags(Client *c, int d)
+{
+  unsigned int i;
+  Monitor *m = c->mon;
+
+  for (i = 0; i < LENGTH(tags); i++) {
+    if (!(c->tags & 1 << i))
+      continue;
+    if ((m->ntagged[i] += d))
+      m->occ |= 1 << i;
+    else
+      m->occ &= ~(1 << i);
+    if (!c->isurgent)
+      continue;
+    if ((m->nurgent[i] += d))
+      m->urg |= 1 << i;
+    else
+      m->urg &= ~(1 << i);
+  }
+  m->nsticky += c->issticky ? d : 0;
 }
 
 Monitor *
@@ -927,6 +1369,19 @@ createmon(void)
   return m;
 }
 
+void
+delfd(int fd)
+{
+  unsigned int i;
+
+  for (i = 0; i < LENGTH(fds); i++)
+    if (fds[i].func && fds[i].fd == fd) {
+      epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+      fds[i].func = NULL;
+      return;
+    }
+}
+
 void
 destroynotify(XEvent *e)
 {
@@ -937,28 +1392,38 @@ destroynotify(XEvent *e)
     unmanage(c, 1);
 
   else if ((c = swallowingclient(ev->window)))
-    unmanage(c->swallowing, 1);
+    unmanage(c->cold->swallowing, 1);
 }
 
 void
 detach(Client *c)
 {
-  Client **tc;
-
-  for (tc = &c->mon->clients; *tc && *tc != c; tc = &(*tc)->next);
-  *tc = c->next;
+  if (c->prev)
+    c->prev->next = c->next;
+  else
+    c->mon->clients = c->next;
+  if (c->next)
+    c->next->prev = c->prev;
+  c->mon->nclients--;
+  c->mon->gen++;
+  c->isattached = 0;
+  counttags(c, -1);
 }
 
 void
 detachstack(Client *c)
 {
-  Client **tc, *t;
+  Client *t;
 
-  for (tc = &c->mon->stack; *tc && *tc != c; tc = &(*tc)->snext);
-  *tc = c->snext;
+  if (c->sprev)
+    c->sprev->snext = c->snext;
+  else
+    c->mon->stack = c->snext;
+  if (c->snext)
+    c->snext->sprev = c->sprev;
 
   if (c == c->mon->sel) {
-    for (t = c->mon->stack; t && !ISVISIBLE(t); t = t->snext);
+    for (t = hasvisible(c->mon) ? c->mon->stack : NULL; t && !ISVISIBLE(t); t = t->snext);
     c->mon->sel = t;
   }
 }
@@ -979,84 +1444,20 @@ dirtomon(int dir)
 }
 
 void
-drawbar(Monitor *m)
+discardprops(Props *p)
 {
-  int x, w;
-  int boxs = drw->fonts->h / 9;
-  int boxw = drw->fonts->h / 6 + 2;
-  unsigned int i, occ = 0, urg = 0;
-  Client *c;
-
-  /* draw status first so it can be overdrawn by tags later */
-  if (m == selmon) { /* status is only drawn on selected monitor */
-    char *ts = stextc;
-    char *tp = stextc;
-    char ctmp;
-
-    drw_setscheme(drw, scheme[SchemeNorm]);
-    x = m->ww - wstext;
-    drw_rect(drw, x, 0, lrpad / 2, bh, 1, 1); /* to keep left padding clean */
-    x += lrpad / 2;
-    for (;;) {
-      if ((unsigned char)*ts > LENGTH(colors) + 10) {
-        ts++;
-        continue;
-      }
-      ctmp = *ts;
-      *ts = '\0';
-      if (*tp != '\0')
-        x = drw_text(drw, x, 0, TTEXTW(tp), bh, 0, tp, 0);
-      if (ctmp == '\0')
-        break;
-      /* - 11 to compensate for + 10 above */
-      drw_setscheme(drw, scheme[ctmp - 11]);
-      *ts = ctmp;
-      tp = ++ts;
-    }
-
-    drw_setscheme(drw, scheme[SchemeNorm]);
-    drw_rect(drw, x, 0, m->ww - x, bh, 1, 1); /* to keep right padding clean */
-  }
-
-  for (c = m->clients; c; c = c->next) {
-    occ |= c->tags;
-    if (c->isurgent)
-      urg |= c->tags;
-  }
-  x = 0;
-  for (i = 0; i < LENGTH(tags); i++) {
-    w = TEXTW(tags[i]);
-    drw_setscheme(drw, scheme[m->tagset[m->seltags] & 1 << i ? SchemeSel : SchemeNorm]);
-    drw_text(drw, x, 0, w, bh, lrpad / 2, tags[i], urg & 1 << i);
-    if (occ & 1 << i)
-      drw_rect(drw, x + boxs, boxs, boxw, boxw,
-          m == selmon && selmon->sel && selmon->sel->tags & 1 << i,
-          urg & 1 << i);
-    x += w;
-  }
-  w = TEXTW(m->ltsymbol);
-  drw_setscheme(drw, scheme[SchemeNorm]);
-  x = drw_text(drw, x, 0, w, bh, lrpad / 2, m->ltsymbol, 0);
+  unsigned int i;
 
-  if (m == selmon) {
-    blw = w, ble = x;
-    w = m->ww - wstext - x;
-  } else {
-    w = m->ww - x;
-  }
+  for (i = 0; i < PropLast; i++)
+    if (p->pending & 1 << i)
+      xcb_discard_reply(xcon, p->seq[i]);
+  p->pending = 0;
+}
 
-  if (w > bh) {
-    if (m->sel) {
-      drw_setscheme(drw, scheme[m == selmon ? SchemeTitle : SchemeNorm]);
-      drw_text(drw, x, 0, w, bh, lrpad / 2, m->sel->name, 0);
-      if (m->sel->isfloating)
-        drw_rect(drw, x + boxs, boxs, boxw, boxw, m->sel->isfixed, 0);
-    } else {
-      drw_setscheme(drw, scheme[SchemeNorm]);
-      drw_rect(drw, x, 0, w, bh, 1, 1);
-    }
-  }
-  drw_map(drw, m->barwin, 0, 0, m->ww, bh);
+void
+drawbar(Monitor *m)
+{
+  m->bar.dirty |= BarCheck;
 }
 
 void
@@ -1088,6 +1489,22 @@ enternotify(XEvent *e)
   focus(c);
 }
 
+Window
+evwin(XEvent *e)
+{
+  switch(e->type) {
+    case ConfigureRequest: return e->xconfigurerequest.window;
+    case DestroyNotify:    return e->xdestroywindow.window;
+    case MapRequest:       return e->xmaprequest.window;
+    case UnmapNotify:      return e->xunmap.window;
+    case ConfigureNotify:  return e->xconfigure.window;
+    case MapNotify:        return e->xmap.window;
+    case CreateNotify:     return e->xcreatewindow.window;
+    case ReparentNotify:   return e->xreparent.window;
+    default:               return e->xany.window;
+  }
+}
+
 void
 expose(XEvent *e)
 {
@@ -1095,24 +1512,40 @@ expose(XEvent *e)
   XExposeEvent *ev = &e->xexpose;
 
   if (ev->count == 0 && (m = wintomon(ev->window)))
-    drawbar(m);
+    m->bar.dirty |= BarAll;
 }
 
 Client *
 findbefore(Client *c)
 {
 	Client *tmp;
-	if (c == selmon->clients)
-		return NULL;
-	for (tmp = selmon->clients; tmp && tmp->next != c; tmp = tmp->next);
+	if (c)
+		return c->mon == selmon ? c->prev : NULL;
+	for (tmp = selmon->clients; tmp && tmp->next; tmp = tmp->next);
 	return tmp;
 }
 
+/* wintab maps the window of every client, and the window a client swallowed,
+ * to that client. It is open addressed with linear probing and Fibonacci
+ * hashing, and kept at most half full so that probing always ends. */
+WinSlot *
+findwin(Window w)
+{
+  unsigned int i, mask = (1U << wintabbits) - 1;
+
+  if (!wintab)
+    return NULL;
+  for (i = w * 11400714819323198485ULL >> (64 - wintabbits); wintab[i].win != None; i = (i + 1) & mask)
+    if (wintab[i].win == w && wintab[i].c)
+      return &wintab[i];
+  return NULL;
+}
+
 void
 focus(Client *c)
 {
   if (!c || !ISVISIBLE(c))
-    for (c = selmon->stack; c && !ISVISIBLE(c); c = c->snext);
+    for (c = hasvisible(selmon) ? selmon->stack : NULL; c && !ISVISIBLE(c); c = c->snext);
   if (selmon->sel && selmon->sel != c)
     unfocus(selmon->sel, 0, c);
   if (c) {
@@ -1143,6 +1576,24 @@ focusin(XEvent *e)
     setfocus(selmon->sel);
 }
 
+/* Text with glyphs the fonts lack is drawn with the first font until drw has
+ * found a fallback font for them, then everything is measured and drawn
+ * again. */
+void
+fontsready(int fd)
+{
+  unsigned int i;
+  Monitor *m;
+
+  if (!drw_fallback_load(drw))
+    return;
+  for (i = 0, tagsw = 0; i < LENGTH(tags); i++)
+    tagsw += tagw[i] = TEXTW(tags[i]);
+  updatestatus();
+  for (m = mons; m; m = m->next)
+    m->bar.dirty |= BarAll;
+}
+
 void
 focusmon(const Arg *arg)
 {
@@ -1164,10 +1615,13 @@ void
 focusstack(const Arg *arg)
 {
   Client *c = NULL, *i;
+  int n;
 
   if (!selmon->sel)
     return;
-  if (GETINC(arg->i) > 0) {
+  if (ISVISIBLE(selmon->sel) && (n = visclients(selmon)))
+    c = selmon->vis[MOD((int)selmon->sel->vispos + (GETINC(arg->i) > 0 ? 1 : -1), n)];
+  else if (GETINC(arg->i) > 0) {
     for (c = selmon->sel->next; c && !ISVISIBLE(c); c = c->next);
     if (!c)
       for (c = selmon->clients; c && !ISVISIBLE(c); c = c->next);
@@ -1187,21 +1641,57 @@ focusstack(const Arg *arg)
 }
 
 Atom
-getatomprop(Client *c, Atom prop)
+getatomprop(Props *p, int prop)
 {
-  int di;
-  unsigned long dl;
-  unsigned char *p = NULL;
-  Atom da, atom = None;
+  Atom atom = None;
+  xcb_get_property_reply_t *r;
 
-  if (XGetWindowProperty(dpy, c->win, prop, 0L, sizeof atom, False, XA_ATOM,
-        &da, &di, &dl, &dl, &p) == Success && p) {
-    atom = *(Atom *)p;
-    XFree(p);
-  }
+  if ((r = propreply(p, prop)) && r->type == XA_ATOM && r->format == 32 && r->value_len)
+    atom = *(uint32_t *)xcb_get_property_value(r);
+  free(r);
   return atom;
 }
 
+int
+getattributes(Props *p, XWindowAttributes *wa)
+{
+  int ok;
+  xcb_get_window_attributes_reply_t *a = NULL;
+  xcb_get_geometry_reply_t *g = NULL;
+
+  if (p->pending & 1 << PropAttributes)
+    a = xcb_get_window_attributes_reply(xcon,
+        (xcb_get_window_attributes_cookie_t){ p->seq[PropAttributes] }, NULL);
+  if (p->pending & 1 << PropGeometry)
+    g = xcb_get_geometry_reply(xcon, (xcb_get_geometry_cookie_t){ p->seq[PropGeometry] }, NULL);
+  p->pending &= ~(1 << PropAttributes | 1 << PropGeometry);
+  if ((ok = a && g)) {
+    memset(wa, 0, sizeof *wa);
+    wa->x = g->x;
+    wa->y = g->y;
+    wa->width = g->width;
+    wa->height = g->height;
+    wa->border_width = g->border_width;
+    wa->depth = g->depth;
+    wa->root = g->root;
+    wa->class = a->_class;
+    wa->map_state = a->map_state;
+    wa->override_redirect = a->override_redirect;
+  }
+  free(a);
+  free(g);
+  return ok;
+}
+
+unsigned long long
+getnsec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
 int
 getrootptr(int *x, int *y)
 {
@@ -1213,25 +1703,32 @@ getrootptr(int *x, int *y)
 }
 
 long
-getstate(Window w)
+getstate(Props *p)
 {
-  int format;
   long result = -1;
-  unsigned char *p = NULL;
-  unsigned long n, extra;
-  Atom real;
+  xcb_get_property_reply_t *r;
 
-  if (XGetWindowProperty(dpy, w, wmatom[WMState], 0L, 2L, False, wmatom[WMState],
-        &real, &format, &n, &extra, (unsigned char **)&p) != Success)
-    return -1;
-  if (n != 0)
-    result = *p;
-  XFree(p);
+  if ((r = propreply(p, PropWMState)) && r->type == wmatom[WMState]
+      && r->format == 32 && r->value_len)
+    result = *(uint32_t *)xcb_get_property_value(r);
+  free(r);
   return result;
 }
 
 int
 gettextprop(Window w, Atom atom, char *text, unsigned int size)
+{
+  int ret;
+  xcb_get_property_reply_t *r;
+
+  r = xcb_get_property_reply(xcon, xcb_get_property(xcon, 0, w, atom, AnyPropertyType, 0, size), NULL);
+  ret = gettextreply(r, text, size);
+  free(r);
+  return ret;
+}
+
+int
+gettextreply(xcb_get_property_reply_t *r, char *text, unsigned int size)
 {
   char **list = NULL;
   int n;
@@ -1240,21 +1737,41 @@ gettextprop(Window w, Atom atom, char *text, unsigned int size)
   if (!text || size == 0)
     return 0;
   text[0] = '\0';
-  if (!XGetTextProperty(dpy, w, &name, atom) || !name.nitems)
+  if (!r || !r->value_len)
     return 0;
-  if (name.encoding == XA_STRING)
-    strncpy(text, (char *)name.value, size - 1);
-  else {
+  name.value = xcb_get_property_value(r);
+  name.encoding = r->type;
+  name.format = r->format;
+  name.nitems = r->value_len;
+  if (name.encoding == XA_STRING) {
+    n = MIN(xcb_get_property_value_length(r), (int)size - 1);
+    memcpy(text, name.value, n);
+    text[n] = '\0';
+  } else {
     if (XmbTextPropertyToTextList(dpy, &name, &list, &n) >= Success && n > 0 && *list) {
       strncpy(text, *list, size - 1);
       XFreeStringList(list);
     }
   }
   text[size - 1] = '\0';
-  XFree(name.value);
   return 1;
 }
 
+Window
+gettransient(Window w, Props *p)
+{
+  Props tp;
+  Window trans = None;
+  xcb_get_property_reply_t *r;
+
+  if (!p)
+    requestprops(w, 1 << PropTransient, p = &tp);
+  if ((r = propreply(p, PropTransient)) && r->type == XA_WINDOW && r->format == 32 && r->value_len)
+    trans = *(uint32_t *)xcb_get_property_value(r);
+  free(r);
+  return trans;
+}
+
 void
 grabbuttons(Client *c, int focused)
 {
@@ -1294,6 +1811,122 @@ grabkeys(void)
   }
 }
 
+void
+histadd(Hist *h, unsigned long long ns)
+{
+  unsigned int b;
+
+  h->n++;
+  h->sum += ns;
+  if (ns > h->max)
+    h->max = ns;
+  for (b = 0; ns > 1 && b < HISTBUCKETS - 1; ns >>= 1)
+    b++;
+  h->bucket[b]++;
+}
+
+void
+histbegin(Stamp *s)
+{
+#ifdef XSTATS
+  s->requests = XNextRequest(dpy);
+  s->roundtrips = roundtrips;
+#endif /* XSTATS */
+  s->t = getnsec();
+}
+
+void
+histdump(void)
+{
+  char name[64];
+  const char *s;
+  unsigned int i;
+
+  fputs("dwm: latency per handler, buckets are upper bounds\n", stderr);
+  for (i = 0; i < LASTEvent; i++)
+    if (evname[i])
+      histprint(evname[i], &evhist[i]);
+  histprint("runpending", &pendinghist);
+  histprint("scan", &scanhist);
+  for (i = 0; i < LENGTH(keys); i++) {
+    if ((s = XKeysymToString(keys[i].keysym)))
+      snprintf(name, sizeof name, "key 0x%x+%s", keys[i].mod, s);
+    else
+      snprintf(name, sizeof name, "key 0x%x+0x%lx", keys[i].mod, keys[i].keysym);
+    histprint(name, &keyhist[i]);
+  }
+  for (i = 0; i < LENGTH(signals); i++) {
+    snprintf(name, sizeof name, "signal %s", signals[i].sig);
+    histprint(name, &sighist[i]);
+  }
+}
+
+void
+histend(Hist *h, const Stamp *s)
+{
+  histadd(h, getnsec() - s->t);
+#ifdef XSTATS
+  h->requests += XNextRequest(dpy) - s->requests;
+  h->roundtrips += roundtrips - s->roundtrips;
+#endif /* XSTATS */
+}
+
+void
+histprint(const char *name, const Hist *h)
+{
+  unsigned int b;
+
+  if (!h->n)
+    return;
+  fprintf(stderr, "%-24s %8lu calls %10.1f us mean %10.1f us max",
+      name, h->n, h->sum / 1e3 / h->n, h->max / 1e3);
+#ifdef XSTATS
+  fprintf(stderr, " %8.1f requests %6.1f round trips",
+      (double)h->requests / h->n, (double)h->roundtrips / h->n);
+#endif /* XSTATS */
+  fputs("\n  ", stderr);
+  for (b = 0; b < HISTBUCKETS; b++)
+    if (h->bucket[b])
+      fprintf(stderr, " %gus:%u", (2ULL << b) / 1e3, h->bucket[b]);
+  fputc('\n', stderr);
+}
+
+void
+hashwin(Window w, Client *c)
+{
+  unsigned int i, mask, n;
+  WinSlot *s, *old = wintab;
+
+  if ((s = findwin(w))) {
+    s->c = c;
+    return;
+  }
+  if (2 * (wintabused + 1) > 1U << wintabbits) {
+    /* grow, or just drop the freed slots */
+    n = 1U << wintabbits;
+    for (wintabbits = 4; 1U << wintabbits < 4 * (wintablive + 1); wintabbits++);
+    wintab = ecalloc(1U << wintabbits, sizeof(WinSlot));
+    wintabused = wintablive = 0;
+    for (i = 0; old && i < n; i++)
+      if (old[i].c)
+        hashwin(old[i].win, old[i].c);
+    free(old);
+  }
+  mask = (1U << wintabbits) - 1;
+  for (i = w * 11400714819323198485ULL >> (64 - wintabbits); wintab[i].c; i = (i + 1) & mask);
+  if (wintab[i].win == None)
+    wintabused++;
+  wintab[i].win = w;
+  wintab[i].c = c;
+  wintablive++;
+}
+
+int
+hasvisible(Monitor *m)
+{
+  return m->nsticky || m->occ & m->tagset[m->seltags];
+}
+
 void
 incnmaster(const Arg *arg)
 {
@@ -1307,6 +1940,208 @@ setnmaster(const Arg *arg)
   arrange(selmon);
 }
 
+void
+ipcaccept(int fd)
+{
+  unsigned int i;
+  int c;
+  struct { pid_t pid; uid_t uid; gid_t gid; } cred; /* struct ucred, hidden behind _GNU_SOURCE */
+  socklen_t len = sizeof cred;
+
+  if ((c = accept(fd, NULL, NULL)) == -1)
+    return;
+  /* the socket is ours only, unless /tmp let someone in before the bind */
+  if (getsockopt(c, SOL_SOCKET, SO_PEERCRED, &cred, &len) == -1 || cred.uid != getuid()) {
+    close(c);
+    return;
+  }
+  for (i = 0; i < LENGTH(fds) && fds[i].func; i++);
+  if (i == LENGTH(fds) || fcntl(c, F_SETFL, O_NONBLOCK) == -1
+      || fcntl(c, F_SETFD, FD_CLOEXEC) == -1) {
+    close(c);
+    return;
+  }
+  addfd(c, ipcread);
+}
+
+/* FNV-1a */
+unsigned int
+ipchash(const char *name, size_t len)
+{
+  unsigned int h = 2166136261u;
+
+  while (len--)
+    h = (h ^ (unsigned char)*name++) * 16777619u;
+  return h;
+}
+
+/* returns the index of the command in signals[], or -1 */
+int
+ipclookup(const char *name, size_t len)
+{
+  unsigned int h;
+  int i;
+
+  for (h = ipchash(name, len); (i = cmdtab[h & (CMDTABSIZE - 1)]); h++)
+    if (!strncmp(signals[i - 1].sig, name, len) && !signals[i - 1].sig[len])
+      return i - 1;
+  return -1;
+}
+
+void
+ipcread(int fd)
+{
+  unsigned char msg[IPCMSGSIZE], reply[IPCMSGSIZE / sizeof(IpcCmd)];
+  char str[IPCMSGSIZE];
+  unsigned int n = 0;
+  uint32_t v;
+  ssize_t len, off;
+  IpcCmd cmd;
+  Arg arg;
+  int type;
+
+  if ((len = recv(fd, msg, sizeof msg, 0)) <= 0) {
+    if (len == 0 || (errno != EAGAIN && errno != EINTR)) {
+      delfd(fd);
+      close(fd);
+    }
+    return;
+  }
+  for (off = 0; off < len; off += sizeof cmd + cmd.namelen + cmd.arglen) {
+    if (len - off < (ssize_t)sizeof cmd) {
+      reply[n++] = IpcMalformed;
+      break;
+    }
+    memcpy(&cmd, msg + off, sizeof cmd);
+    if (len - off - (ssize_t)sizeof cmd < cmd.namelen + cmd.arglen) {
+      reply[n++] = IpcMalformed;
+      break;
+    }
+    arg = (Arg){0};
+    type = cmd.argtype;
+    if (type == IpcArgString || type == IpcArgText) {
+      memcpy(str, msg + off + sizeof cmd + cmd.namelen, cmd.arglen);
+      str[cmd.arglen] = '\0';
+      arg.v = str;
+      if (type == IpcArgText)
+        type = ipcparse((char *)msg + off + sizeof cmd, cmd.namelen, str, &arg);
+    } else if (type != IpcArgNone) {
+      if (cmd.arglen != sizeof v) {
+        reply[n++] = IpcBadArg;
+        continue;
+      }
+      memcpy(&v, msg + off + sizeof cmd + cmd.namelen, sizeof v);
+      switch(cmd.argtype) {
+        case IpcArgInt:   arg.i = (int32_t)v; break;
+        case IpcArgUint:  arg.ui = v; break;
+        case IpcArgFloat: memcpy(&arg.f, &v, sizeof arg.f); break;
+      }
+    }
+    reply[n++] = ipcrun((char *)msg + off + sizeof cmd, cmd.namelen, type, &arg);
+  }
+  if (trace)
+    fflush(trace);
+  send(fd, reply, n, MSG_NOSIGNAL);
+}
+
+/* Reads text as the argument type of the command into arg, returns that
+ * type, or -1 if the command takes no argument or text is not one */
+int
+ipcparse(const char *name, size_t len, const char *text, Arg *arg)
+{
+  char *end;
+  int i;
+
+  if ((i = ipclookup(name, len)) == -1)
+    return IpcArgString; /* ipcrun() answers IpcUnknown */
+  switch(signals[i].argtype) {
+    case NoArg:
+      return -1;
+    case IpcArgString:
+      return IpcArgString;
+    case IpcArgUint:
+      arg->ui = strtoul(text, &end, 0);
+      break;
+    case IpcArgFloat:
+      arg->f = strtof(text, &end);
+      break;
+    default:
+      arg->i = strtol(text, &end, 0);
+      break;
+  }
+  if (!*text || *end)
+    return -1;
+  return signals[i].argtype == IpcArgNone ? IpcArgInt : signals[i].argtype;
+}
+
+int
+ipcrun(const char *name, size_t len, int argtype, const Arg *arg)
+{
+  int i;
+
+  if (argtype < IpcArgNone || argtype > IpcArgString)
+    return IpcBadArg;
+  if ((i = ipclookup(name, len)) == -1 || !signals[i].func)
+    return IpcUnknown;
+  if (signals[i].argtype == NoArg ? argtype != IpcArgNone
+      : (signals[i].argtype == IpcArgString) != (argtype == IpcArgString))
+    return IpcBadArg;
+  if (trace) {
+    tracerecord(TraceCommand);
+    traceput(i);
+    traceput(argtype);
+    if (argtype == IpcArgString) {
+      traceput(strlen(arg->v));
+      fwrite(arg->v, 1, strlen(arg->v), trace);
+    } else
+      traceput(arg->i);
+  }
+  runsignal(i, arg);
+  return IpcOk;
+}
+
+/* dwm keeps running without the socket if it cannot be set up */
+void
+ipcsetup(void)
+{
+  struct sockaddr_un addr = { .sun_family = AF_UNIX };
+  const char *display = getenv("DISPLAY");
+  unsigned int i, h;
+  mode_t mask;
+  int r;
+
+  for (i = 0; i < LENGTH(signals); i++) {
+    for (h = ipchash(signals[i].sig, strlen(signals[i].sig)); cmdtab[h & (CMDTABSIZE - 1)]; h++);
+    cmdtab[h & (CMDTABSIZE - 1)] = i + 1;
+  }
+  if ((size_t)snprintf(ipcpath, sizeof ipcpath, IPCPATH, IPCDIR, display ? display : "") >= sizeof ipcpath)
+    return;
+  strcpy(addr.sun_path, ipcpath);
+  if ((ipcfd = socket(AF_UNIX, SOCK_SEQPACKET, 0)) == -1)
+    goto fail;
+  if (connect(ipcfd, (struct sockaddr *)&addr, sizeof addr) == 0) {
+    fprintf(stderr, "dwm: %s is in use by another instance\n", ipcpath);
+    close(ipcfd);
+    ipcfd = -1;
+    return;
+  }
+  unlink(ipcpath); /* left behind by a dwm that did not exit cleanly */
+  if (fcntl(ipcfd, F_SETFD, FD_CLOEXEC) == -1)
+    goto fail;
+  mask = umask(077); /* created 0600, not chmod()ed after others could connect */
+  r = bind(ipcfd, (struct sockaddr *)&addr, sizeof addr);
+  umask(mask);
+  if (r == -1 || listen(ipcfd, SOMAXCONN) == -1)
+    goto fail;
+  addfd(ipcfd, ipcaccept);
+  return;
+fail:
+  perror("dwm: ipc socket");
+  if (ipcfd != -1)
+    close(ipcfd);
+  ipcfd = -1;
+}
+
 #ifdef XINERAMA
 static int
 isuniquegeom(XineramaScreenInfo *unique, size_t n, XineramaScreenInfo *info)
@@ -1323,6 +2158,7 @@ void
 keypress(XEvent *e)
 {
   unsigned int i;
+  Stamp st;
   KeySym keysym;
   XKeyEvent *ev;
 
@@ -1331,51 +2167,50 @@ keypress(XEvent *e)
   for (i = 0; i < LENGTH(keys); i++)
     if (keysym == keys[i].keysym
         && CLEANMASK(keys[i].mod) == CLEANMASK(ev->state)
-        && keys[i].func)
+        && keys[i].func) {
+      histbegin(&st);
       keys[i].func(&(keys[i].arg));
+      histend(&keyhist[i], &st);
+    }
 }
 
+/* runs text of the form "fsignal:<name> [<type> <value>]", returns 0 if it
+ * is not a command */
 int
-fake_signal(void)
-{
-  char fsignal[256];
-  char indicator[9] = "fsignal:";
-  char str_sig[50];
-  char param[16];
-  int i, len_str_sig, n, paramn;
-  size_t len_fsignal, len_indicator = strlen(indicator);
-  Arg arg;
-
-  // Get root name property
-  if (gettextprop(root, XA_WM_NAME, fsignal, sizeof(fsignal))) {
-    len_fsignal = strlen(fsignal);
-
-    // Check if this is indeed a fake signal
-    if (len_indicator > len_fsignal ? 0 : strncmp(indicator, fsignal, len_indicator) == 0) {
-      paramn = sscanf(fsignal+len_indicator, "%s%n%s%n", str_sig, &len_str_sig, param, &n);
-
-      if (paramn == 1) arg = (Arg) {0};
-      else if (paramn > 2) return 1;
-      else if (strncmp(param, "i", n - len_str_sig) == 0)
-        sscanf(fsignal + len_indicator + n, "%i", &(arg.i));
-      else if (strncmp(param, "ui", n - len_str_sig) == 0)
-        sscanf(fsignal + len_indicator + n, "%u", &(arg.ui));
-      else if (strncmp(param, "f", n - len_str_sig) == 0)
-        sscanf(fsignal + len_indicator + n, "%f", &(arg.f));
-      else return 1;
-
-      // Check if a signal was found, and if so handle it
-      for (i = 0; i < LENGTH(signals); i++)
-        if (strncmp(str_sig, signals[i].sig, len_str_sig) == 0 && signals[i].func)
-          signals[i].func(&(arg));
-
-      // A fake signal was sent
-      return 1;
-    }
-  }
+fake_signal(const char *text)
+{
+  static const char prefix[] = "fsignal:";
+  const char *name, *type, *value;
+  size_t len, typelen;
+  Arg arg = {0};
+  int i;
 
-  // No fake signal was sent, so proceed with update
-  return 0;
+  if (strncmp(text, prefix, sizeof prefix - 1))
+    return 0;
+  if (trace)
+    tracesignal(text);
+  name = text + sizeof prefix - 1;
+  len = strcspn(name, " ");
+  if ((i = ipclookup(name, len)) == -1 || !signals[i].func)
+    return 1;
+  type = name + len + strspn(name + len, " ");
+  typelen = strcspn(type, " ");
+  value = type + typelen + strspn(type + typelen, " ");
+  if (typelen == 1 && *type == 'i')
+    arg.i = strtol(value, NULL, 0);
+  else if (typelen == 2 && !strncmp(type, "ui", 2))
+    arg.ui = strtoul(value, NULL, 0);
+  else if (typelen == 1 && *type == 'f')
+    arg.f = strtof(value, NULL);
+  else if (typelen == 1 && *type == 's')
+    arg.v = value; /* the rest of the name, spaces included */
+  else if (typelen)
+    return 1;
+  if (signals[i].argtype == NoArg ? typelen != 0
+      : (signals[i].argtype == IpcArgString) != (typelen == 1 && *type == 's'))
+    return 1;
+  runsignal(i, &arg);
+  return 1;
 }
 
 void
@@ -1395,15 +2230,15 @@ killclient(const Arg *arg)
 }
 
 void
-manage(Window w, XWindowAttributes *wa)
+manage(Window w, XWindowAttributes *wa, Props *p)
 {
   Client *c, *t = NULL, *term = NULL;
   Window trans = None;
   XWindowChanges wc;
 
-  c = ecalloc(1, sizeof(Client));
+  c = allocclient();
   c->win = w;
-  c->pid = winpid(w);
+  c->cold->pid = winpid(p);
   /* geometry */
   c->x = c->oldx = wa->x;
   c->y = c->oldy = wa->y;
@@ -1411,13 +2246,13 @@ manage(Window w, XWindowAttributes *wa)
   c->h = c->oldh = wa->height;
   c->oldbw = wa->border_width;
 
-  updatetitle(c);
-  if (XGetTransientForHint(dpy, w, &trans) && (t = wintoclient(trans))) {
+  updatetitle(c, p);
+  if ((trans = gettransient(w, p)) && (t = wintoclient(trans))) {
     c->mon = t->mon;
     c->tags = t->tags;
   } else {
     c->mon = selmon;
-    applyrules(c);
+    applyrules(c, p);
     term = termforwin(c);
   }
 
@@ -1435,9 +2270,10 @@ manage(Window w, XWindowAttributes *wa)
   XConfigureWindow(dpy, w, CWBorderWidth, &wc);
   XSetWindowBorder(dpy, w, scheme[SchemeNorm][ColBorder].pixel);
   configure(c); /* propagates border_width, if size doesn't change */
-  updatewindowtype(c);
-  updatesizehints(c);
-  updatewmhints(c);
+  updatewindowtype(c, p);
+  updatesizehints(c, p);
+  updatewmhints(c, p);
+  discardprops(p); /* WM_CLASS of transients */
   XSelectInput(dpy, w, EnterWindowMask|FocusChangeMask|PropertyChangeMask|StructureNotifyMask);
   grabbuttons(c, 0);
   if (!c->isfloating)
@@ -1446,9 +2282,11 @@ manage(Window w, XWindowAttributes *wa)
     XRaiseWindow(dpy, c->win);
   attachtop(c);
   attachstack(c);
+  hashwin(c->win, c);
   XChangeProperty(dpy, root, netatom[NetClientList], XA_WINDOW, 32, PropModeAppend,
       (unsigned char *) &(c->win), 1);
   XMoveResizeWindow(dpy, c->win, c->x + 2 * sw, c->y, c->w, c->h); /* some windows require this */
+  c->ishidden = 1; /* showhide() moves it in place */
   setclientstate(c, NormalState);
 
   if (c->mon == selmon)
@@ -1458,7 +2296,18 @@ manage(Window w, XWindowAttributes *wa)
   XMapWindow(dpy, c->win);
   if (term)
     swallow(term, c);
-  focus(NULL);
+  if (!scanning)
+    focus(NULL);
+}
+
+void
+markurgent(Client *c, int urg)
+{
+  if (c->isattached)
+    counttags(c, -1);
+  c->isurgent = urg;
+  if (c->isattached)
+    counttags(c, 1);
 }
 
 void
@@ -1474,15 +2323,17 @@ mappingnotify(XEvent *e)
 void
 maprequest(XEvent *e)
 {
-  static XWindowAttributes wa;
+  XWindowAttributes wa;
+  Props p;
   XMapRequestEvent *ev = &e->xmaprequest;
 
-  if (!XGetWindowAttributes(dpy, ev->window, &wa))
-    return;
-  if (wa.override_redirect)
+  if (wintoclient(ev->window))
     return;
-  if (!wintoclient(ev->window))
-    manage(ev->window, &wa);
+  requestprops(ev->window, PROPMANAGE | 1 << PropAttributes | 1 << PropGeometry, &p);
+  if (getattributes(&p, &wa) && !wa.override_redirect)
+    manage(ev->window, &wa, &p);
+  else
+    discardprops(&p);
 }
 
 void
@@ -1534,6 +2385,7 @@ movemouse(const Arg *arg)
   if (!getrootptr(&x, &y))
     return;
   do {
+    runpending();
     XMaskEvent(dpy, MOUSEMASK|ExposureMask|SubstructureRedirectMask, &ev);
     switch(ev.type) {
       case ConfigureRequest:
@@ -1572,23 +2424,45 @@ movemouse(const Arg *arg)
   }
 }
 
+/* Returns the first tiled client from c on, going through m->vis once a
+ * visible one is reached, so that only hidden clients right after c are
+ * walked in the list. */
 Client *
 nexttiled(Client *c)
 {
-  for (; c && (c->isfloating || !ISVISIBLE(c)); c = c->next);
-  return c;
+  Monitor *m;
+  unsigned int i, n;
+
+  if (!c)
+    return NULL;
+  m = c->mon;
+  n = visclients(m);
+  if (c == m->clients)
+    i = 0;
+  else {
+    for (; c && !ISVISIBLE(c); c = c->next);
+    if (!c)
+      return NULL;
+    i = c->vispos;
+  }
+  for (; i < n && m->vis[i]->isfloating; i++);
+  return i < n ? m->vis[i] : NULL;
 }
 
 void
 propertynotify(XEvent *e)
 {
+  char text[256];
   Client *c;
   Window trans;
   XPropertyEvent *ev = &e->xproperty;
 
   if ((ev->window == root) && (ev->atom == XA_WM_NAME)) {
-    if (!fake_signal())
-      updatestatus();
+    /* fetched once for both, a command is never shown as status */
+    if (!gettextprop(root, XA_WM_NAME, text, sizeof text))
+      setstatus(NULL);
+    else if (!fake_signal(text))
+      setstatus(text);
   }
   else if (ev->state == PropertyDelete)
     return; /* ignore */
@@ -1596,28 +2470,37 @@ propertynotify(XEvent *e)
     switch(ev->atom) {
       default: break;
       case XA_WM_TRANSIENT_FOR:
-               if (!c->isfloating && (XGetTransientForHint(dpy, c->win, &trans)) &&
+               if (!c->isfloating && (trans = gettransient(c->win, NULL)) &&
                    (c->isfloating = (wintoclient(trans)) != NULL))
                  arrange(c->mon);
                break;
       case XA_WM_NORMAL_HINTS:
-               updatesizehints(c);
+               updatesizehints(c, NULL);
                break;
       case XA_WM_HINTS:
-               updatewmhints(c);
+               updatewmhints(c, NULL);
                drawbars();
                break;
     }
     if (ev->atom == XA_WM_NAME || ev->atom == netatom[NetWMName]) {
-      updatetitle(c);
+      updatetitle(c, NULL);
       if (c == c->mon->sel)
         drawbar(c->mon);
     }
     if (ev->atom == netatom[NetWMWindowType])
-      updatewindowtype(c);
+      updatewindowtype(c, NULL);
   }
 }
 
+xcb_get_property_reply_t *
+propreply(Props *p, int prop)
+{
+  if (!(p->pending & 1 << prop))
+    return NULL;
+  p->pending &= ~(1 << prop);
+  return xcb_get_property_reply(xcon, (xcb_get_property_cookie_t){ p->seq[prop] }, NULL);
+}
+
 Monitor *
 recttomon(int x, int y, int w, int h)
 {
@@ -1632,6 +2515,176 @@ recttomon(int x, int y, int w, int h)
   return r;
 }
 
+/* Redraws the regions of the bar whose content changed since the last call and
+ * copies them to the bar window at once. The pixmap is shared between
+ * monitors, so the redrawn regions are kept contiguous. */
+void
+renderbar(Monitor *m)
+{
+  int x, w, tx, sx, x0, x1, bx0, bx1;
+  int boxs = drw->fonts->h / 9;
+  int boxw = drw->fonts->h / 6 + 2;
+  unsigned int i, occ = m->occ, urg = m->urg, seltags, titleflags, dirty, seg;
+  const char *title = m->sel ? m->sel->cold->name : "";
+  Bar *b = &m->bar;
+
+  seltags = m == selmon && selmon->sel ? selmon->sel->tags : 0;
+  titleflags = m->sel ? 1 | m->sel->isfloating << 1 | m->sel->isfixed << 2 : 0;
+  x = tagsw;
+  tx = x + TEXTW(m->ltsymbol);
+  sx = m == selmon ? m->ww - wstext : m->ww;
+
+  dirty = b->dirty & BarAll;
+  if ((m == selmon) != b->isselmon || m->ww != b->ww || sx < tx)
+    dirty = BarAll;
+  if (occ != b->occ || urg != b->urg || seltags != b->seltags || m->tagset[m->seltags] != b->tagset)
+    dirty |= BarTags;
+  if (strcmp(m->ltsymbol, b->ltsymbol))
+    dirty |= BarLtSymbol;
+  if (titleflags != b->titleflags || strcmp(title, b->title) || tx != b->tx || sx != b->sx)
+    dirty |= BarTitle;
+  b->dirty = 0;
+  if (!dirty)
+    return;
+  /* fill the gaps between damaged regions */
+  for (i = BarTags; i <= BarStatus; i <<= 1)
+    if ((dirty & (i - 1)) && (dirty & ~((i << 1) - 1)))
+      dirty |= i;
+  x0 = dirty & BarTags ? 0 : dirty & BarLtSymbol ? x : dirty & BarTitle ? tx : sx;
+  x1 = dirty & BarStatus ? m->ww : dirty & BarTitle ? sx : dirty & BarLtSymbol ? tx : x;
+
+  /* draw status first so it can be overdrawn by tags later */
+  if (m == selmon && dirty & BarStatus) { /* status is only drawn on selected monitor */
+    /* only the blocks that changed, if nothing else did and none moved */
+    if (!blockmode || dirty != BarStatus)
+      blockdirty = ~0;
+    drw_setscheme(drw, scheme[SchemeNorm]);
+    x = sx;
+    if (blockdirty == ~0u)
+      drw_rect(drw, x, 0, lrpad / 2, bh, 1, 1); /* to keep left padding clean */
+    x += lrpad / 2;
+    if (!blockmode)
+      x = statustext(x, stextc, 1);
+    else {
+      bx0 = m->ww, bx1 = 0;
+      for (i = 1; i < STATUSBLOCKS; i++) {
+        if (!blocks[i].text || !(blockdirty & 1u << i)) {
+          x += blocks[i].w;
+          continue;
+        }
+        bx0 = MIN(bx0, x);
+        drw_setscheme(drw, scheme[SchemeNorm]);
+        x = statustext(x, blocks[i].text, 1);
+        bx1 = x;
+      }
+      if (blockdirty != ~0u)
+        x0 = bx0, x1 = bx1;
+    }
+    if (blockdirty == ~0u) {
+      drw_setscheme(drw, scheme[SchemeNorm]);
+      drw_rect(drw, x, 0, m->ww - x, bh, 1, 1); /* to keep right padding clean */
+    }
+    blockdirty = 0;
+  }
+
+  x = 0;
+  for (i = 0; i < LENGTH(tags); i++) {
+    w = tagw[i];
+    seg = (m->tagset[m->seltags] & 1 << i ? SegSel : 0) | (urg & 1 << i ? SegUrg : 0)
+      | (occ & 1 << i ? SegOcc : 0) | (seltags & 1 << i ? SegFocus : 0);
+    /* each tag is only rasterized once in each of its states */
+    if (dirty & BarTags && !drw_seg_copy(drw, tags[i], seg, x, 0, w, bh)) {
+      drw_setscheme(drw, scheme[seg & SegSel ? SchemeSel : SchemeNorm]);
+      drw_text(drw, x, 0, w, bh, lrpad / 2, tags[i], urg & 1 << i);
+      if (occ & 1 << i)
+        drw_rect(drw, x + boxs, boxs, boxw, boxw, seltags & 1 << i, urg & 1 << i);
+      drw_seg_save(drw, tags[i], seg, x, 0, w, bh);
+    }
+    x += w;
+  }
+  w = tx - x;
+  if (dirty & BarLtSymbol && !drw_seg_copy(drw, m->ltsymbol, SegLtSymbol, x, 0, w, bh)) {
+    drw_setscheme(drw, scheme[SchemeNorm]);
+    drw_text(drw, x, 0, w, bh, lrpad / 2, m->ltsymbol, 0);
+    drw_seg_save(drw, m->ltsymbol, SegLtSymbol, x, 0, w, bh);
+  }
+  x = tx;
+  if (m == selmon)
+    blw = w, ble = x;
+
+  w = sx - x;
+  if (dirty & BarTitle && w > 0) {
+    if (m->sel && w > bh) {
+      drw_setscheme(drw, scheme[m == selmon ? SchemeTitle : SchemeNorm]);
+      drw_text(drw, x, 0, w, bh, lrpad / 2, m->sel->cold->name, 0);
+      if (m->sel->isfloating)
+        drw_rect(drw, x + boxs, boxs, boxw, boxw, m->sel->isfixed, 0);
+    } else {
+      drw_setscheme(drw, scheme[SchemeNorm]);
+      drw_rect(drw, x, 0, w, bh, 1, 1);
+    }
+  }
+  if (x1 > x0)
+    drw_map(drw, m->barwin, x0, 0, x1 - x0, bh);
+
+  b->isselmon = m == selmon;
+  b->ww = m->ww;
+  b->tx = tx;
+  b->sx = sx;
+  b->occ = occ;
+  b->urg = urg;
+  b->tagset = m->tagset[m->seltags];
+  b->seltags = seltags;
+  b->titleflags = titleflags;
+  strcpy(b->ltsymbol, m->ltsymbol);
+  strncpy(b->title, title, sizeof b->title - 1);
+}
+
+/* Sends the requests for everything in mask about w without waiting for the
+ * replies, which are collected by the functions reading them. Whatever is
+ * not read must be given back through discardprops(). This makes fetching
+ * the properties a single round trip, the rest of manage() (grabbuttons(),
+ * the WM_PROTOCOLS lookup, the pointer query) still waits on its own. */
+void
+requestprops(Window w, unsigned int mask, Props *p)
+{
+  unsigned int i;
+  const struct { Atom prop, type; uint32_t len; } q[] = { /* len in 32-bit units */
+    [PropNetWMName]       = { netatom[NetWMName],       AnyPropertyType,  256 },
+    [PropWMName]          = { XA_WM_NAME,               AnyPropertyType,  256 },
+    [PropClass]           = { XA_WM_CLASS,              XA_STRING,        256 },
+    [PropTransient]       = { XA_WM_TRANSIENT_FOR,      XA_WINDOW,        1 },
+    [PropNetWMState]      = { netatom[NetWMState],      XA_ATOM,          1 },
+    [PropNetWMWindowType] = { netatom[NetWMWindowType], XA_ATOM,          1 },
+    [PropNormalHints]     = { XA_WM_NORMAL_HINTS,       XA_WM_SIZE_HINTS, 18 },
+    [PropHints]           = { XA_WM_HINTS,              XA_WM_HINTS,      9 },
+    [PropWMState]         = { wmatom[WMState],          wmatom[WMState],  2 },
+  };
+
+  p->pending = mask;
+  for (i = 0; i < PropLast; i++) {
+    if (!(mask & 1 << i))
+      continue;
+    switch(i) {
+      case PropAttributes:
+        p->seq[i] = xcb_get_window_attributes(xcon, w).sequence;
+        break;
+      case PropGeometry:
+        p->seq[i] = xcb_get_geometry(xcon, w).sequence;
+        break;
+      case PropPid: {
+        xcb_res_client_id_spec_t spec = { w, XCB_RES_CLIENT_ID_MASK_LOCAL_CLIENT_PID };
+
+        p->seq[i] = xcb_res_query_client_ids(xcon, 1, &spec).sequence;
+        break;
+      }
+      default:
+        p->seq[i] = xcb_get_property(xcon, 0, w, q[i].prop, q[i].type, 0, q[i].len).sequence;
+        break;
+    }
+  }
+}
+
 void
 resize(Client *c, int x, int y, int w, int h, int bw, int interact)
 {
@@ -1642,6 +2695,9 @@ resize(Client *c, int x, int y, int w, int h, int bw, int interact)
 void
 resizeclient(Client *c, int x, int y, int w, int h, int bw)
 {
+  unsigned int mask = (x != c->x ? CWX : 0) | (y != c->y ? CWY : 0)
+    | (w != c->w ? CWWidth : 0) | (h != c->h ? CWHeight : 0)
+    | (bw != c->bw ? CWBorderWidth : 0);
   XWindowChanges wc;
 
   c->oldx = c->x; c->x = wc.x = x;
@@ -1649,8 +2705,14 @@ resizeclient(Client *c, int x, int y, int w, int h, int bw)
   c->oldw = c->w; c->w = wc.width = w;
   c->oldh = c->h; c->h = wc.height = h;
   c->oldbw = c->bw; c->bw = wc.border_width = bw;
-  XConfigureWindow(dpy, c->win, CWX|CWY|CWWidth|CWHeight|CWBorderWidth, &wc);
-  configure(c);
+  if (mask)
+    XConfigureWindow(dpy, c->win, mask, &wc);
+  if (mask & CWX)
+    c->ishidden = 0;
+  /* the server tells the client about size and border changes itself,
+   * anything else needs a synthetic event (ICCCM 4.1.5) */
+  if (!(mask & (CWWidth|CWHeight|CWBorderWidth)))
+    configure(c);
 	if (c->fakefullscreen == 1)
 		/* Exception: if the client was in actual fullscreen and we exit out to fake fullscreen
 		 * mode, then the focus would drift to whichever window is under the mouse cursor at the
@@ -1658,8 +2720,7 @@ resizeclient(Client *c, int x, int y, int w, int h, int bw)
 		 * other events in the queue thus cancelling the EnterNotify event that would otherwise
 		 * have changed focus. */
 		XSync(dpy, True);
-	else
-		XSync(dpy, False);
+	/* otherwise the request is flushed with the rest at the end of the loop iteration */
 }
 
 void
@@ -1683,6 +2744,7 @@ resizemouse(const Arg *arg)
     return;
   XWarpPointer(dpy, None, c->win, 0, 0, 0, 0, c->w + c->bw - 1, c->h + c->bw - 1);
   do {
+    runpending();
     XMaskEvent(dpy, MOUSEMASK|ExposureMask|SubstructureRedirectMask, &ev);
     switch(ev.type) {
       case ConfigureRequest:
@@ -1719,12 +2781,19 @@ resizemouse(const Arg *arg)
   }
 }
 
+/* Tiled windows are stacked below the bar in focus order. Only the windows
+ * from the first one out of the order last sent are restacked: the ones
+ * before it are still in place, as windows raised, mapped or moved to another
+ * monitor since leave the order, and anything else that can come between
+ * them clears m->stacked. */
 void
 restack(Monitor *m)
 {
   Client *c;
   XEvent ev;
   XWindowChanges wc;
+  unsigned int n;
+  int moved = 0;
 
   drawbar(m);
   if (!m->sel)
@@ -1732,57 +2801,140 @@ restack(Monitor *m)
   if (m->sel->isfloating || !m->lt[m->sellt]->arrange)
     XRaiseWindow(dpy, m->sel->win);
   if (m->lt[m->sellt]->arrange) {
+    if (m->nclients > m->stackedsize) {
+      free(m->stacked);
+      m->stacked = ecalloc(m->stackedsize = m->nclients, sizeof(Window));
+      m->nstacked = 0;
+    }
     wc.stack_mode = Below;
     wc.sibling = m->barwin;
-    for (c = m->stack; c; c = c->snext)
+    for (n = 0, c = m->stack; c; c = c->snext)
       if (!c->isfloating && ISVISIBLE(c)) {
-        XConfigureWindow(dpy, c->win, CWSibling|CWStackMode, &wc);
+        if (moved || n >= m->nstacked || m->stacked[n] != c->win) {
+          XConfigureWindow(dpy, c->win, CWSibling|CWStackMode, &wc);
+          moved = 1;
+        }
+        if (n < m->stackedsize)
+          m->stacked[n++] = c->win;
         wc.sibling = c->win;
       }
+    m->nstacked = n;
+  } else
+    m->nstacked = 0;
+  XSync(dpy, False);
+  while (XCheckMaskEvent(dpy, EnterWindowMask, &ev));
+
+  if (m == selmon && (m->tagset[m->seltags] & m->sel->tags) && selmon->lt[selmon->sellt] != &layouts[2])
+    warp(m->sel);
+}
+
+void
+run(void)
+{
+  int i, n;
+  Stamp st;
+  Fd *f;
+  struct epoll_event ev[LENGTH(fds)];
+
+  /* main event loop */
+  XSync(dpy, False);
+  while (running) {
+    /* handlers may have read events off the socket, into the Xlib
+     * queue or into xcb's alongside a reply, where epoll cannot see them */
+    if (XEventsQueued(dpy, QueuedAfterReading))
+      xevents(ConnectionNumber(dpy));
+    histbegin(&st);
+    runpending();
+    histend(&pendinghist, &st);
+    if (XEventsQueued(dpy, QueuedAfterReading))
+      continue;
+    XFlush(dpy); /* send everything queued during this iteration at once */
+    if ((n = epoll_wait(epfd, ev, LENGTH(ev), -1)) == -1) {
+      if (errno == EINTR)
+        continue;
+      die("epoll_wait:");
+    }
+    for (i = 0; i < n && running; i++) {
+      f = ev[i].data.ptr;
+      if (f->func)
+        f->func(f->fd);
+    }
   }
-  XSync(dpy, False);
-  while (XCheckMaskEvent(dpy, EnterWindowMask, &ev));
+}
 
-  if (m == selmon && (m->tagset[m->seltags] & m->sel->tags) && selmon->lt[selmon->sellt] != &layouts[2])
-    warp(m->sel);
+void
+runpending(void)
+{
+  Monitor *m;
+  unsigned int needarrange;
+
+  for (m = mons; m; m = m->next)
+    if (m->needarrange)
+      showhide(m->stack);
+  for (m = mons; m; m = m->next) {
+    if (!(needarrange = m->needarrange))
+      continue;
+    m->needarrange = 0;
+    arrangemon(m);
+    if (needarrange & ArrangeStack)
+      restack(m);
+  }
+  for (m = mons; m; m = m->next)
+    if (m->bar.dirty)
+      renderbar(m);
 }
 
+/* runs signals[i], whichever channel it came from */
 void
-run(void)
+runsignal(int i, const Arg *arg)
 {
-  XEvent ev;
-  /* main event loop */
-  XSync(dpy, False);
-  while (running && !XNextEvent(dpy, &ev))
-    if (handler[ev.type])
-      handler[ev.type](&ev); /* call handler */
+  Stamp st;
+
+  histbegin(&st);
+  signals[i].func(arg);
+  histend(&sighist[i], &st);
 }
 
 void
 scan(void)
 {
-  unsigned int i, num;
+  unsigned int i, j, num = 0;
+  long state;
+  Stamp st;
+  int ok;
   Window d1, d2, *wins = NULL;
-  XWindowAttributes wa;
-
-  if (XQueryTree(dpy, root, &d1, &d2, &wins, &num)) {
+  struct { XWindowAttributes wa; Props p; int istrans; } *s;
+
+  histbegin(&st);
+  if (XQueryTree(dpy, root, &d1, &d2, &wins, &num) && num) {
+    /* ask about all children at once, then once more about the ones to
+     * manage, instead of a round-trip per window and question */
+    s = ecalloc(num, sizeof *s);
+    for (i = 0; i < num; i++)
+      requestprops(wins[i], 1 << PropAttributes | 1 << PropGeometry
+          | 1 << PropTransient | 1 << PropWMState, &s[i].p);
     for (i = 0; i < num; i++) {
-      if (!XGetWindowAttributes(dpy, wins[i], &wa)
-          || wa.override_redirect || XGetTransientForHint(dpy, wins[i], &d1))
-        continue;
-      if (wa.map_state == IsViewable || getstate(wins[i]) == IconicState)
-        manage(wins[i], &wa);
-    }
-    for (i = 0; i < num; i++) { /* now the transients */
-      if (!XGetWindowAttributes(dpy, wins[i], &wa))
-        continue;
-      if (XGetTransientForHint(dpy, wins[i], &d1)
-          && (wa.map_state == IsViewable || getstate(wins[i]) == IconicState))
-        manage(wins[i], &wa);
+      ok = getattributes(&s[i].p, &s[i].wa);
+      state = getstate(&s[i].p);
+      s[i].istrans = gettransient(wins[i], &s[i].p) != None;
+      if (!ok || s[i].wa.override_redirect
+          || (s[i].wa.map_state != IsViewable && state != IconicState))
+        wins[i] = None;
+      else
+        requestprops(wins[i], PROPMANAGE, &s[i].p);
     }
-    if (wins)
-      XFree(wins);
+    scanning = 1;
+    for (j = 0; j < 2; j++) /* the transients after the others */
+      for (i = 0; i < num; i++)
+        if (wins[i] != None && s[i].istrans == j)
+          manage(wins[i], &s[i].wa, &s[i].p);
+    scanning = 0;
+    free(s);
+    focus(NULL);
   }
+  if (wins)
+    XFree(wins);
+  histend(&scanhist, &st);
 }
 
 void
@@ -1801,6 +2953,49 @@ sendmon(Client *c, Monitor *m)
   arrange(NULL);
 }
 
+/* arg->v is "<id> <text>", a text with nothing but delimiters removes the block */
+void
+setblock(const Arg *arg)
+{
+  const char *text;
+  char *end, *s, *t;
+  long id;
+  int w, i;
+  Block *b;
+
+  if (!arg->v)
+    return;
+  if ((id = strtol(arg->v, &end, 10)) < 1 || id >= STATUSBLOCKS || (*end && *end != ' '))
+    return;
+  text = *end ? end + 1 : end;
+  b = &blocks[id];
+  /* bytes up to 10 delimit blocks in the root name, drop them */
+  s = t = ecalloc(strlen(text) + 1, 1);
+  for (; *text; text++)
+    if ((unsigned char)*text > 10)
+      *t++ = *text;
+  if (!*s) {
+    free(s);
+    s = NULL;
+  }
+  if (b->text && s ? !strcmp(b->text, s) : b->text == s) {
+    free(s);
+    return;
+  }
+  free(b->text);
+  b->text = s;
+  w = b->text ? statustext(0, b->text, 0) : 0;
+  if (w != b->w || !blockmode) { /* the blocks left of it move */
+    b->w = w;
+    blockmode = 1;
+    blockdirty = ~0;
+    for (i = 1, wstext = lrpad; i < STATUSBLOCKS; i++)
+      wstext += blocks[i].w;
+  } else
+    blockdirty |= 1u << id;
+  selmon->bar.dirty |= BarStatus;
+}
+
 void
 setclientstate(Client *c, long state)
 {
@@ -1959,11 +3154,96 @@ setmfact(const Arg *arg)
 void
 loadfonts()
 {
+  unsigned int i;
+  int fd;
+
+  if (drw) {
+    if ((fd = drw_fallback_fd(drw)) != -1)
+      delfd(fd);
+    drw_free(drw);
+  }
   drw = drw_create(dpy, screen, root, sw, sh, visual, depth, cmap);
   if (!drw_fontset_create(drw, font))
     die("no fonts could be loaded.");
+  if ((fd = drw_fallback_fd(drw)) != -1)
+    addfd(fd, fontsready);
   lrpad = drw->fonts->h;
   bh = MAX((drw->fonts->h + 2), barheight); // set bar height
+  for (i = 0, tagsw = 0; i < LENGTH(tags); i++)
+    tagsw += tagw[i] = TEXTW(tags[i]);
+}
+
+/* splits the root name into the status texts, NULL shows the version */
+void
+setstatus(const char *text)
+{
+  if (blockmode)
+    return;
+  if (text) {
+    char stextt[256];
+    char *stc = stextc, *sts = stexts, *stt = stextt;
+
+    for (const char *rt = text; *rt != '\0'; rt++)
+      if ((unsigned char)*rt >= ' ')
+        *(stc++) = *(sts++) = *(stt++) = *rt;
+      else if ((unsigned char)*rt > 10)
+        *(stc++) = *rt;
+      else
+        *(sts++) = *rt;
+    *stc = *sts = *stt = '\0';
+    wstext = TEXTW(stextt);
+  } else {
+    strcpy(stextc, "dwm-"VERSION);
+    strcpy(stexts, stextc);
+    wstext = TEXTW(stextc);
+  }
+  selmon->bar.dirty |= BarStatus;
+}
+
+void
+setgeom(Client *c, Geom *g, int x, int y, int w, int h, int bw)
+{
+  g->x = x;
+  g->y = y;
+  g->w = w;
+  g->h = h;
+  g->bw = bw;
+  applysizehints(c, &g->x, &g->y, &g->w, &g->h, &g->bw, 0);
+}
+
+void
+settags(Client *c, unsigned int newtags)
+{
+  counttags(c, -1);
+  c->tags = newtags;
+  counttags(c, 1);
+  c->mon->gen++;
+}
+
+void
+settimer(int timer, unsigned int ms)
+{
+  unsigned long long when = getnsec() + ms * 1000000ULL;
+
+  /* keep an earlier deadline, so deferred work is never postponed */
+  if (!timers[timer] || when < timers[timer])
+    timers[timer] = when;
+  armtimers();
+}
+
+void
+armtimers(void)
+{
+  int i;
+  unsigned long long next = 0;
+  struct itimerspec its = {{0}};
+
+  for (i = 0; i < TimerLast; i++)
+    if (timers[i] && (!next || timers[i] < next))
+      next = timers[i];
+  its.it_value.tv_sec = next / 1000000000ULL;
+  its.it_value.tv_nsec = next % 1000000000ULL;
+  timerfd_settime(tmrfd, TFD_TIMER_ABSTIME, &its, NULL);
 }
 
 void
@@ -1973,8 +3253,25 @@ setup(void)
   XSetWindowAttributes wa;
   Atom utf8string;
 
+  /* children are reaped and SIGUSR1 is answered from the event loop
+   * through a signalfd */
+  sigemptyset(&sigmask);
+  sigaddset(&sigmask, SIGCHLD);
+  sigaddset(&sigmask, SIGUSR1);
+  if (sigprocmask(SIG_BLOCK, &sigmask, NULL) == -1)
+    die("sigprocmask:");
+  if ((epfd = epoll_create1(EPOLL_CLOEXEC)) == -1)
+    die("epoll_create1:");
+  if ((sigfd = signalfd(-1, &sigmask, SFD_NONBLOCK|SFD_CLOEXEC)) == -1)
+    die("signalfd:");
+  if ((tmrfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC)) == -1)
+    die("timerfd_create:");
+  addfd(ConnectionNumber(dpy), xevents);
+  addfd(sigfd, signalevent);
+  addfd(tmrfd, timerevent);
+  ipcsetup();
   /* clean up any zombies immediately */
-  sigchld(0);
+  signalevent(sigfd);
 
   /* init screen */
   screen = DefaultScreen(dpy);
@@ -2044,7 +3341,7 @@ seturgent(Client *c, int urg)
 {
   XWMHints *wmh;
 
-  c->isurgent = urg;
+  markurgent(c, urg);
   if (!(wmh = XGetWMHints(dpy, c->win)))
     return;
   wmh->flags = urg ? (wmh->flags | XUrgencyHint) : (wmh->flags & ~XUrgencyHint);
@@ -2058,23 +3355,32 @@ showhide(Client *c)
   if (!c)
     return;
   if (ISVISIBLE(c)) {
-    /* show clients top down */
-    XMoveWindow(dpy, c->win, c->x, c->y);
+    /* show clients top down, those not moved off screen are in place */
+    if (c->ishidden) {
+      XMoveWindow(dpy, c->win, c->x, c->y);
+      c->ishidden = 0;
+    }
     if ((!c->mon->lt[c->mon->sellt]->arrange || c->isfloating) && !c->isfullscreen)
       resize(c, c->x, c->y, c->w, c->h, c->bw, 0);
     showhide(c->snext);
   } else {
     /* hide clients bottom up */
     showhide(c->snext);
-    XMoveWindow(dpy, c->win, WIDTH(c) * -2, c->y);
+    if (!c->ishidden) {
+      XMoveWindow(dpy, c->win, WIDTH(c) * -2, c->y);
+      c->ishidden = 1;
+    }
   }
 }
 
 void
-sigchld(int unused)
+signalevent(int fd)
 {
-  if (signal(SIGCHLD, sigchld) == SIG_ERR)
-    die("can't install SIGCHLD handler:");
+  struct signalfd_siginfo si;
+
+  while (read(fd, &si, sizeof si) == sizeof si)
+    if (si.ssi_signo == SIGUSR1)
+      histdump();
   while (0 < waitpid(-1, NULL, WNOHANG));
 }
 
@@ -2108,6 +3414,7 @@ spawn(const Arg *arg)
   if (fork() == 0) {
     if (dpy)
       close(ConnectionNumber(dpy));
+    sigprocmask(SIG_UNBLOCK, &sigmask, NULL);
     setsid();
     execvp(((char **)arg->v)[0], (char **)arg->v);
     fprintf(stderr, "dwm: execvp %s", ((char **)arg->v)[0]);
@@ -2120,7 +3427,7 @@ void
 tag(const Arg *arg)
 {
   if (selmon->sel && arg->ui & TAGMASK) {
-    selmon->sel->tags = arg->ui & TAGMASK;
+    settags(selmon->sel, arg->ui & TAGMASK);
     focus(NULL);
     arrange(selmon);
   }
@@ -2157,14 +3464,9 @@ tagmon(const Arg *arg)
 }
 
 void
-tile(Monitor *m)
+tile(Monitor *m, Client **c, Geom *g, unsigned int n)
 {
-  unsigned int i, n, h, r, oe = gapsenabled, ie = gapsenabled, mw, my, ty, bw;
-  Client *c;
-
-  for (n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), n++);
-  if (n == 0)
-    return;
+  unsigned int i, h, r, oe = gapsenabled, ie = gapsenabled, mw, my, ty, bw;
 
   if (n == 1 && !monhasgaps(selmon))
     bw = 0;
@@ -2179,32 +3481,26 @@ tile(Monitor *m)
     mw = m->nmaster ? (m->ww + m->gappiv*ie) * m->mfact : 0;
   else
     mw = m->ww - 2*m->gappov*oe + m->gappiv*ie;
-  for (i = 0, my = ty = m->gappoh*oe, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++)
+  for (i = 0, my = ty = m->gappoh*oe; i < n; i++)
     if (i < m->nmaster) {
       r = MIN(n, m->nmaster) - i;
       h = (m->wh - my - m->gappoh*oe - m->gappih*ie * (r - 1)) / r;
-      resize(c, m->wx + m->gappov*oe, m->wy + my, mw - (2*bw) - m->gappiv*ie, h - (2*bw), bw, 0);
-      if (my + HEIGHT(c) + m->gappih*ie < m->wh)
-        my += HEIGHT(c) + m->gappih*ie;
+      setgeom(c[i], &g[i], m->wx + m->gappov*oe, m->wy + my, mw - (2*bw) - m->gappiv*ie, h - (2*bw), bw);
+      if (my + HEIGHT(&g[i]) + m->gappih*ie < m->wh)
+        my += HEIGHT(&g[i]) + m->gappih*ie;
     } else {
       r = n - i;
       h = (m->wh - ty - m->gappoh*oe - m->gappih*ie * (r - 1)) / r;
-      resize(c, m->wx + mw + m->gappov*oe, m->wy + ty, m->ww - mw - (2*bw) - 2*m->gappov*oe, h - (2*bw), bw, 0);
-      if (ty + HEIGHT(c) + m->gappih*ie < m->wh)
-        ty += HEIGHT(c) + m->gappih*ie;
+      setgeom(c[i], &g[i], m->wx + mw + m->gappov*oe, m->wy + ty, m->ww - mw - (2*bw) - 2*m->gappov*oe, h - (2*bw), bw);
+      if (ty + HEIGHT(&g[i]) + m->gappih*ie < m->wh)
+        ty += HEIGHT(&g[i]) + m->gappih*ie;
     }
 }
 
 void
-centeredmaster(Monitor *m)
+centeredmaster(Monitor *m, Client **c, Geom *g, unsigned int n)
 {
-  unsigned int i, n, h, mw, mx, my, oty, ety, tw, bw;
-  Client *c;
-
-  /* count number of clients in the selected monitor */
-  for (n = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), n++);
-  if (n == 0)
-    return;
+  unsigned int i, h, mw, mx, my, oty, ety, tw, bw;
 
   if (n == 1 && !monhasgaps(selmon))
     bw = 0;
@@ -2231,30 +3527,46 @@ centeredmaster(Monitor *m)
 
   oty = 0;
   ety = 0;
-  for (i = 0, c = nexttiled(m->clients); c; c = nexttiled(c->next), i++)
+  for (i = 0; i < n; i++)
     if (i < m->nmaster) {
       /* nmaster clients are stacked vertically, in the center
        * of the screen */
       h = (m->wh - my) / (MIN(n, m->nmaster) - i);
-      resize(c, m->wx + mx, m->wy + my, mw - (2*c->bw),
-          h - (2*c->bw), bw, 0);
-      my += HEIGHT(c);
+      setgeom(c[i], &g[i], m->wx + mx, m->wy + my, mw - (2*c[i]->bw),
+          h - (2*c[i]->bw), bw);
+      my += HEIGHT(&g[i]);
     } else {
       /* stack clients are stacked vertically */
       if ((i - m->nmaster) % 2 ) {
         h = (m->wh - ety) / ( (1 + n - i) / 2);
-        resize(c, m->wx, m->wy + ety, tw - (2*c->bw),
-            h - (2*c->bw), bw, 0);
-        ety += HEIGHT(c);
+        setgeom(c[i], &g[i], m->wx, m->wy + ety, tw - (2*c[i]->bw),
+            h - (2*c[i]->bw), bw);
+        ety += HEIGHT(&g[i]);
       } else {
         h = (m->wh - oty) / ((1 + n - i) / 2);
-        resize(c, m->wx + mx + mw, m->wy + oty,
-            tw - (2*c->bw), h - (2*c->bw), bw, 0);
-        oty += HEIGHT(c);
+        setgeom(c[i], &g[i], m->wx + mx + mw, m->wy + oty,
+            tw - (2*c[i]->bw), h - (2*c[i]->bw), bw);
+        oty += HEIGHT(&g[i]);
       }
     }
 }
 
+void
+timerevent(int fd)
+{
+  int i;
+  uint64_t exp;
+  unsigned long long now = getnsec();
+
+  while (read(fd, &exp, sizeof exp) == sizeof exp);
+  for (i = 0; i < TimerLast; i++)
+    if (timers[i] && timers[i] <= now) {
+      timers[i] = 0;
+      timerfunc[i]();
+    }
+  armtimers();
+}
+
 void
 togglebar(const Arg *arg)
 {
@@ -2320,7 +3632,10 @@ togglesticky(const Arg *arg)
 {
 	if (!selmon->sel)
 		return;
+	counttags(selmon->sel, -1);
 	selmon->sel->issticky = !selmon->sel->issticky;
+	counttags(selmon->sel, 1);
+	selmon->gen++;
 	arrange(selmon);
 }
 
@@ -2333,7 +3648,7 @@ toggletag(const Arg *arg)
     return;
   newtags = selmon->sel->tags ^ (arg->ui & TAGMASK);
   if (newtags) {
-    selmon->sel->tags = newtags;
+    settags(selmon->sel, newtags);
     focus(NULL);
     arrange(selmon);
   }
@@ -2381,12 +3696,114 @@ toggleview(const Arg *arg)
   }
 }
 
+/* atoms other than the predefined ones and dwm's own are not kept */
+long
+traceatom(Atom a)
+{
+  int i;
+
+  if (a <= XA_LAST_PREDEFINED)
+    return a;
+  for (i = 0; i < WMLast; i++)
+    if (wmatom[i] == a)
+      return XA_LAST_PREDEFINED + 1 + i;
+  for (i = 0; i < NetLast; i++)
+    if (netatom[i] == a)
+      return XA_LAST_PREDEFINED + 1 + WMLast + i;
+  return None;
+}
+
+#define TRACEF(X) traceput(X);
+#define TRACEW(X) traceput(tracewin(X));
+#define TRACEA(X) traceput(traceatom(X));
+#define TRACEK(X) traceput(XKeycodeToKeysym(dpy, X, 0));
+
+void
+traceevent(XEvent *e)
+{
+  tracerecord(e->type);
+  TRACEFIELDS(e, TRACEF, TRACEW, TRACEA, TRACEK)
+}
+
+/* zigzag encoded LEB128, small magnitudes of either sign take one byte */
+void
+traceput(long v)
+{
+  unsigned long u = ((unsigned long)v << 1) ^ (v < 0 ? ~0UL : 0);
+
+  for (; u > 0x7f; u >>= 7)
+    putc((u & 0x7f) | 0x80, trace);
+  putc(u, trace);
+}
+
+/* every record starts with its type and the microseconds since the last one */
+void
+tracerecord(int type)
+{
+  unsigned long long dt = (getnsec() - tracet) / 1000;
+
+  putc(type, trace);
+  traceput(dt);
+  tracet += dt * 1000;
+}
+
+void
+tracescan(void)
+{
+  Client *c;
+  Monitor *m;
+
+  tracet = getnsec();
+  fputs(TRACEMAGIC, trace);
+  for (m = mons; m; m = m->next)
+    for (c = m->clients; c; c = c->next) {
+      tracerecord(TraceWindow);
+      traceput(tracewin(c->win));
+    }
+  fflush(trace);
+}
+
+void
+tracesignal(const char *cmd)
+{
+  size_t len = strlen(cmd);
+
+  tracerecord(TraceSignal);
+  traceput(len);
+  fwrite(cmd, 1, len, trace);
+}
+
+/* the root window is 1, bars are 2 plus their monitor and clients keep their id */
+long
+tracewin(Window w)
+{
+  Monitor *m;
+
+  if (w == root)
+    return 1;
+  for (m = mons; m; m = m->next)
+    if (w == m->barwin)
+      return 2 + m->num;
+  return w;
+}
+
 void
 toggleviewex(const Arg *arg)
 {
   toggleview(&((Arg){.ui = 1 << arg->ui}));
 }
 
+void
+unhashwin(Window w)
+{
+  WinSlot *s;
+
+  if ((s = findwin(w))) {
+    s->c = NULL;
+    wintablive--;
+  }
+}
+
 void
 unfocus(Client *c, int setfocus, Client *nextfocus)
 {
@@ -2409,15 +3826,16 @@ unmanage(Client *c, int destroyed)
   Monitor *m = c->mon;
   XWindowChanges wc;
 
-  if (c->swallowing) {
+  if (c->cold->swallowing) {
     unswallow(c);
     return;
   }
 
   Client *s = swallowingclient(c->win);
   if (s) {
-    free(s->swallowing);
-    s->swallowing = NULL;
+    unhashwin(c->win);
+    freeclient(s->cold->swallowing);
+    s->cold->swallowing = NULL;
     arrange(m);
     focus(NULL);
     return;
@@ -2425,6 +3843,10 @@ unmanage(Client *c, int destroyed)
 
   detach(c);
   detachstack(c);
+  unhashwin(c->win);
+  m->nstacked = 0; /* its id may come back on a window stacked elsewhere */
+  if (c == prevzoom)
+    prevzoom = NULL;
   if (!destroyed) {
     wc.border_width = c->oldbw;
     XGrabServer(dpy); /* avoid race conditions */
@@ -2436,12 +3858,12 @@ unmanage(Client *c, int destroyed)
     XSetErrorHandler(xerror);
     XUngrabServer(dpy);
   }
-  free(c);
+  freeclient(c);
 
   if (!s) {
     arrange(m);
     focus(NULL);
-    updateclientlist();
+    settimer(TimerClientList, 0);
   }
 }
 
@@ -2516,7 +3938,20 @@ updatedsblockssig(int x)
   char *ts = stexts;
   char *tp = stexts;
   char ctmp;
+  int i;
 
+  if (blockmode) {
+    for (i = 1; i < STATUSBLOCKS; i++)
+      if (blocks[i].w && (x += blocks[i].w) >= 0) {
+        if (!statushandcursor) {
+          statushandcursor = 1;
+          XDefineCursor(dpy, selmon->barwin, cursor[CurHand]->cursor);
+        }
+        dsblockssig = i;
+        return;
+      }
+    goto cursorondelimiter;
+  }
   while (*ts != '\0') {
     if ((unsigned char)*ts > 10) {
       ts++;
@@ -2593,7 +4028,7 @@ updategeom(void)
         for (m = mons; m && m->next; m = m->next);
         while ((c = m->clients)) {
           dirty = 1;
-          m->clients = c->next;
+          detach(c);
           detachstack(c);
           c->mon = mons;
           attachtop(c);
@@ -2641,88 +4076,117 @@ updatenumlockmask(void)
 }
 
 void
-updatesizehints(Client *c)
+updatesizehints(Client *c, Props *p)
 {
-  long msize;
-  XSizeHints size;
-
-  if (!XGetWMNormalHints(dpy, c->win, &size, &msize))
-    /* size is uninitialized, ensure that size.flags aren't used */
+  Props tp;
+  uint32_t *v;
+  XSizeHints size = { 0 };
+  xcb_get_property_reply_t *r;
+
+  if (!p)
+    requestprops(c->win, 1 << PropNormalHints, p = &tp);
+  if ((r = propreply(p, PropNormalHints)) && r->type == XA_WM_SIZE_HINTS
+      && r->format == 32 && r->value_len >= 15) {
+    v = xcb_get_property_value(r);
+    size.flags = v[0];
+    size.min_width = (int)v[5];
+    size.min_height = (int)v[6];
+    size.max_width = (int)v[7];
+    size.max_height = (int)v[8];
+    size.width_inc = (int)v[9];
+    size.height_inc = (int)v[10];
+    size.min_aspect.x = (int)v[11];
+    size.min_aspect.y = (int)v[12];
+    size.max_aspect.x = (int)v[13];
+    size.max_aspect.y = (int)v[14];
+    if (r->value_len >= 18) {
+      size.base_width = (int)v[15];
+      size.base_height = (int)v[16];
+    } else /* pre-ICCCM 1.0 hints */
+      size.flags &= ~(PBaseSize|PWinGravity);
+  } else
+    /* no usable hints, ensure that size.flags aren't used */
     size.flags = PSize;
+  free(r);
   if (size.flags & PBaseSize) {
-    c->basew = size.base_width;
-    c->baseh = size.base_height;
+    c->cold->basew = size.base_width;
+    c->cold->baseh = size.base_height;
   } else if (size.flags & PMinSize) {
-    c->basew = size.min_width;
-    c->baseh = size.min_height;
+    c->cold->basew = size.min_width;
+    c->cold->baseh = size.min_height;
   } else
-    c->basew = c->baseh = 0;
+    c->cold->basew = c->cold->baseh = 0;
   if (size.flags & PResizeInc) {
-    c->incw = size.width_inc;
-    c->inch = size.height_inc;
+    c->cold->incw = size.width_inc;
+    c->cold->inch = size.height_inc;
   } else
-    c->incw = c->inch = 0;
+    c->cold->incw = c->cold->inch = 0;
   if (size.flags & PMaxSize) {
-    c->maxw = size.max_width;
-    c->maxh = size.max_height;
+    c->cold->maxw = size.max_width;
+    c->cold->maxh = size.max_height;
   } else
-    c->maxw = c->maxh = 0;
+    c->cold->maxw = c->cold->maxh = 0;
   if (size.flags & PMinSize) {
-    c->minw = size.min_width;
-    c->minh = size.min_height;
+    c->cold->minw = size.min_width;
+    c->cold->minh = size.min_height;
   } else if (size.flags & PBaseSize) {
-    c->minw = size.base_width;
-    c->minh = size.base_height;
+    c->cold->minw = size.base_width;
+    c->cold->minh = size.base_height;
   } else
-    c->minw = c->minh = 0;
+    c->cold->minw = c->cold->minh = 0;
   if (size.flags & PAspect) {
-    c->mina = (float)size.min_aspect.y / size.min_aspect.x;
-    c->maxa = (float)size.max_aspect.x / size.max_aspect.y;
+    c->cold->mina = (float)size.min_aspect.y / size.min_aspect.x;
+    c->cold->maxa = (float)size.max_aspect.x / size.max_aspect.y;
   } else
-    c->maxa = c->mina = 0.0;
-  c->isfixed = (c->maxw && c->maxh && c->maxw == c->minw && c->maxh == c->minh);
+    c->cold->maxa = c->cold->mina = 0.0;
+  c->isfixed = (c->cold->maxw && c->cold->maxh && c->cold->maxw == c->cold->minw && c->cold->maxh == c->cold->minh);
 }
 
+/* also measures the blocks again after the fonts changed */
 void
 updatestatus(void)
 {
-  char rawstext[256];
-
-  if (gettextprop(root, XA_WM_NAME, rawstext, sizeof rawstext)) {
-    char stextt[256];
-    char *stc = stextc, *sts = stexts, *stt = stextt;
+  char text[256];
+  int i;
 
-    for (char *rt = rawstext; *rt != '\0'; rt++)
-      if ((unsigned char)*rt >= ' ')
-        *(stc++) = *(sts++) = *(stt++) = *rt;
-      else if ((unsigned char)*rt > 10)
-        *(stc++) = *rt;
-      else
-        *(sts++) = *rt;
-    *stc = *sts = *stt = '\0';
-    wstext = TEXTW(stextt);
-  } else {
-    strcpy(stextc, "dwm-"VERSION);
-    strcpy(stexts, stextc);
-    wstext = TEXTW(stextc);
+  if (!blockmode) {
+    setstatus(gettextprop(root, XA_WM_NAME, text, sizeof text) ? text : NULL);
+    return;
   }
-  drawbar(selmon);
+  for (i = 1, wstext = lrpad; i < STATUSBLOCKS; i++)
+    wstext += blocks[i].w = blocks[i].text ? statustext(0, blocks[i].text, 0) : 0;
+  blockdirty = ~0;
+  selmon->bar.dirty |= BarStatus;
 }
 
 void
-updatetitle(Client *c)
+updatetitle(Client *c, Props *p)
 {
-  if (!gettextprop(c->win, netatom[NetWMName], c->name, sizeof c->name))
-    gettextprop(c->win, XA_WM_NAME, c->name, sizeof c->name);
-  if (c->name[0] == '\0') /* hack to mark broken clients */
-    strcpy(c->name, broken);
+  Props tp;
+  xcb_get_property_reply_t *netname, *name;
+
+  if (!p)
+    requestprops(c->win, 1 << PropNetWMName | 1 << PropWMName, p = &tp);
+  netname = propreply(p, PropNetWMName);
+  name = propreply(p, PropWMName);
+  if (!gettextreply(netname, c->cold->name, sizeof c->cold->name))
+    gettextreply(name, c->cold->name, sizeof c->cold->name);
+  free(netname);
+  free(name);
+  if (c->cold->name[0] == '\0') /* hack to mark broken clients */
+    strcpy(c->cold->name, broken);
 }
 
 void
-updatewindowtype(Client *c)
+updatewindowtype(Client *c, Props *p)
 {
-  Atom state = getatomprop(c, netatom[NetWMState]);
-  Atom wtype = getatomprop(c, netatom[NetWMWindowType]);
+  Props tp;
+  Atom state, wtype;
+
+  if (!p)
+    requestprops(c->win, 1 << PropNetWMState | 1 << PropNetWMWindowType, p = &tp);
+  state = getatomprop(p, PropNetWMState);
+  wtype = getatomprop(p, PropNetWMWindowType);
 
   if (state == netatom[NetWMFullscreen])
     setfullscreen(c, 1);
@@ -2731,22 +4195,38 @@ updatewindowtype(Client *c)
 }
 
 void
-updatewmhints(Client *c)
+updatewmhints(Client *c, Props *p)
 {
-  XWMHints *wmh;
-
-  if ((wmh = XGetWMHints(dpy, c->win))) {
-    if (c == selmon->sel && wmh->flags & XUrgencyHint) {
-      wmh->flags &= ~XUrgencyHint;
-      XSetWMHints(dpy, c->win, wmh);
+  Props tp;
+  uint32_t *v;
+  XWMHints wmh;
+  xcb_get_property_reply_t *r;
+
+  if (!p)
+    requestprops(c->win, 1 << PropHints, p = &tp);
+  if ((r = propreply(p, PropHints)) && r->type == XA_WM_HINTS
+      && r->format == 32 && r->value_len >= 8) {
+    v = xcb_get_property_value(r);
+    wmh.flags = v[0];
+    wmh.input = v[1];
+    wmh.initial_state = v[2];
+    wmh.icon_pixmap = v[3];
+    wmh.icon_window = v[4];
+    wmh.icon_x = (int)v[5];
+    wmh.icon_y = (int)v[6];
+    wmh.icon_mask = v[7];
+    wmh.window_group = r->value_len >= 9 ? v[8] : None;
+    if (c == selmon->sel && wmh.flags & XUrgencyHint) {
+      wmh.flags &= ~XUrgencyHint;
+      XSetWMHints(dpy, c->win, &wmh);
     } else
-      c->isurgent = (wmh->flags & XUrgencyHint) ? 1 : 0;
-    if (wmh->flags & InputHint)
-      c->neverfocus = !wmh->input;
+      markurgent(c, (wmh.flags & XUrgencyHint) ? 1 : 0);
+    if (wmh.flags & InputHint)
+      c->neverfocus = !wmh.input;
     else
       c->neverfocus = 0;
-    XFree(wmh);
   }
+  free(r);
 }
 
 void
@@ -2787,6 +4267,29 @@ view(const Arg *arg)
   arrange(selmon);
 }
 
+/* Returns the number of visible clients of m, after bringing m->vis and their
+ * vispos up to date if clients or the view changed since the last call. */
+unsigned int
+visclients(Monitor *m)
+{
+  Client *c;
+
+  if (m->visgen == m->gen && m->vistags == m->tagset[m->seltags])
+    return m->nvis;
+  if (m->nclients > m->vissize) {
+    free(m->vis);
+    m->vis = ecalloc(m->vissize = m->nclients, sizeof(Client *));
+  }
+  for (m->nvis = 0, c = m->clients; c; c = c->next)
+    if (ISVISIBLE(c)) {
+      c->vispos = m->nvis;
+      m->vis[m->nvis++] = c;
+    }
+  m->visgen = m->gen;
+  m->vistags = m->tagset[m->seltags];
+  return m->nvis;
+}
+
 void
 viewall(const Arg *arg)
 {
@@ -2800,20 +4303,18 @@ viewex(const Arg *arg)
 }
 
   pid_t
-winpid(Window w)
+winpid(Props *p)
 {
 
   pid_t result = 0;
+  xcb_res_client_id_spec_t spec;
+  xcb_res_query_client_ids_reply_t *r;
 
-#ifdef __linux__
-  xcb_res_client_id_spec_t spec = {0};
-  spec.client = w;
-  spec.mask = XCB_RES_CLIENT_ID_MASK_LOCAL_CLIENT_PID;
-
-  xcb_generic_error_t *e = NULL;
-  xcb_res_query_client_ids_cookie_t c = xcb_res_query_client_ids(xcon, 1, &spec);
-  xcb_res_query_client_ids_reply_t *r = xcb_res_query_client_ids_reply(xcon, c, &e);
-
+  if (!(p->pending & 1 << PropPid))
+    return (pid_t)0;
+  p->pending &= ~(1 << PropPid);
+  r = xcb_res_query_client_ids_reply(xcon,
+      (xcb_res_query_client_ids_cookie_t){ p->seq[PropPid] }, NULL);
   if (!r)
     return (pid_t)0;
 
@@ -2832,23 +4333,6 @@ winpid(Window w)
   if (result == (pid_t)-1)
     result = 0;
 
-#endif /* __linux__ */
-
-#ifdef __OpenBSD__
-  Atom type;
-  int format;
-  unsigned long len, bytes;
-  unsigned char *prop;
-  pid_t ret;
-
-  if (XGetWindowProperty(dpy, w, XInternAtom(dpy, "_NET_WM_PID", 1), 0, 1, False, AnyPropertyType, &type, &format, &len, &bytes, &prop) != Success || !prop)
-    return 0;
-
-  ret = *(pid_t*)prop;
-  XFree(prop);
-  result = ret;
-
-#endif /* __OpenBSD__ */
   return result;
 }
 
@@ -2856,8 +4340,6 @@ winpid(Window w)
 getparentprocess(pid_t p)
 {
   unsigned int v = 0;
-
-#ifdef __linux__
   FILE *f;
   char buf[256];
   snprintf(buf, sizeof(buf) - 1, "/proc/%u/stat", (unsigned)p);
@@ -2867,20 +4349,6 @@ getparentprocess(pid_t p)
 
   fscanf(f, "%*u %*s %*c %u", &v);
   fclose(f);
-#endif /* __linux__*/
-
-#ifdef __OpenBSD__
-  int n;
-  kvm_t *kd;
-  struct kinfo_proc *kp;
-
-  kd = kvm_openfiles(NULL, NULL, NULL, KVM_NO_FILES, NULL);
-  if (!kd)
-    return 0;
-
-  kp = kvm_getprocs(kd, KERN_PROC_PID, p, sizeof(*kp), &n);
-  v = kp->p_ppid;
-#endif /* __OpenBSD__ */
 
   return (pid_t)v;
 }
@@ -2900,12 +4368,12 @@ termforwin(const Client *w)
   Client *c;
   Monitor *m;
 
-  if (!w->pid || w->isterminal)
+  if (!w->cold->pid || w->cold->isterminal)
     return NULL;
 
   for (m = mons; m; m = m->next) {
     for (c = m->clients; c; c = c->next) {
-      if (c->isterminal && !c->swallowing && c->pid && isdescprocess(c->pid, w->pid))
+      if (c->cold->isterminal && !c->cold->swallowing && c->cold->pid && isdescprocess(c->cold->pid, w->cold->pid))
         return c;
     }
   }
@@ -2916,17 +4384,9 @@ termforwin(const Client *w)
   Client *
 swallowingclient(Window w)
 {
-  Client *c;
-  Monitor *m;
-
-  for (m = mons; m; m = m->next) {
-    for (c = m->clients; c; c = c->next) {
-      if (c->swallowing && c->swallowing->win == w)
-        return c;
-    }
-  }
+  WinSlot *s = findwin(w);
 
-  return NULL;
+  return s && s->c->cold->swallowing && s->c->cold->swallowing->win == w ? s->c : NULL;
 }
 
 void
@@ -2954,14 +4414,9 @@ warp(const Client *c)
 Client *
 wintoclient(Window w)
 {
-  Client *c;
-  Monitor *m;
+  WinSlot *s = findwin(w);
 
-  for (m = mons; m; m = m->next)
-    for (c = m->clients; c; c = c->next)
-      if (c->win == w)
-        return c;
-  return NULL;
+  return s && s->c->win == w ? s->c : NULL;
 }
 
 void
@@ -3020,6 +4475,35 @@ wintomon(Window w)
   return selmon;
 }
 
+void
+xevents(int fd)
+{
+  int i, n, len, type;
+  Stamp st;
+
+  while (running && (n = XPending(dpy))) {
+    for (len = 0; len < n && len < LENGTH(evq); len++) {
+      XNextEvent(dpy, &evq[len]);
+      coalesce(evq, len);
+      /* button handlers may read the queue themselves (movemouse, resizemouse) */
+      if (evq[len].type == ButtonPress) {
+        len++;
+        break;
+      }
+    }
+    for (i = 0; i < len && running; i++)
+      if (handler[type = evq[i].type]) {
+        if (trace)
+          traceevent(&evq[i]);
+        histbegin(&st);
+        handler[type](&evq[i]); /* call handler */
+        histend(&evhist[type], &st);
+      }
+  }
+  if (trace)
+    fflush(trace);
+}
+
 /* There's no way to check accesses to destroyed windows, thus those cases are
  * ignored (especially on UnmapNotify's). Other types of errors call Xlibs
  * default error handler, which may call exit. */
@@ -3093,6 +4577,21 @@ xinitvisual()
   }
 }
 
+#ifdef XSTATS
+/* Waiting for the reply to request seq, or for a reply to a request about to
+ * be sent if seq is 0, is a round trip unless an earlier one already flushed
+ * it. Requests are counted from Xlib's sequence numbers, which only catch up
+ * with those sent through xcb at the next Xlib request. */
+void
+xstatswait(unsigned int seq)
+{
+  if (seq && (int)(seq - syncseq) <= 0)
+    return;
+  roundtrips++;
+  syncseq = XNextRequest(dpy);
+}
+#endif /* XSTATS */
+
 void
 zoom(const Arg *arg)
 {
@@ -3122,8 +4621,7 @@ zoom(const Arg *arg)
 		prevzoom = cold;
 		if (cold && at != cold) {
 			detach(cold);
-			cold->next = at->next;
-			at->next = cold;
+			attachafter(cold, at);
 		}
 	}
 	focus(c);
@@ -3197,12 +4695,15 @@ reloadxresources(const Arg *arg)
 
   loadxresources();
   loadfonts();
+  updatestatus();
 
   for (i = 0; i < LENGTH(colors); i++) {
+    free(scheme[i]);
     scheme[i] = drw_scm_create(drw, colors[i], baralpha, 3);
   }
 
   for (m = mons; m; m = m->next) {
+    m->bar.dirty |= BarAll;
     if (oldborderpx != borderpx) {
       for (c = m->clients; c; c = c->next) {
         c->bw = borderpx;
@@ -3218,23 +4719,71 @@ reloadxresources(const Arg *arg)
     }
   }
 
-  XSetWindowBorder(dpy, selmon->sel->win, scheme[SchemeSel][ColBorder].pixel);
+  if (selmon->sel)
+    XSetWindowBorder(dpy, selmon->sel->win, scheme[SchemeSel][ColBorder].pixel);
   defaultgaps(NULL);
 }
 
 void
 startdsblocks()
 {
-  system("export STATUSBAR=\"dsblocks\" ; pidof -s dsblocks >/dev/null || dsblocks &");
+  /* unblock in the child only, a SIGUSR1 reaching dwm while unblocked
+   * would kill it; the shell is reaped from the event loop */
+  if (fork() == 0) {
+    if (dpy)
+      close(ConnectionNumber(dpy));
+    sigprocmask(SIG_UNBLOCK, &sigmask, NULL);
+    execl("/bin/sh", "sh", "-c",
+        "export STATUSBAR=\"dsblocks\" ; pidof -s dsblocks >/dev/null || dsblocks &",
+        (char *)NULL);
+    perror("dwm: execl /bin/sh failed");
+    exit(EXIT_SUCCESS);
+  }
+}
+
+/* Draws status text with the color codes of the root name at x, or only
+ * measures it if draw is 0, and returns where it ends. The codes are bytes
+ * 11 to 10 + LENGTH(colors) and select colors[code - 11]. */
+int
+statustext(int x, char *text, int draw)
+{
+  char *ts = text;
+  char *tp = text;
+  char ctmp;
+
+  for (;;) {
+    if ((unsigned char)*ts > LENGTH(colors) + 10) {
+      ts++;
+      continue;
+    }
+    ctmp = *ts;
+    *ts = '\0';
+    if (*tp != '\0')
+      x = draw ? drw_text(drw, x, 0, TTEXTW(tp), bh, 0, tp, 0) : x + TTEXTW(tp);
+    *ts = ctmp;
+    if (ctmp == '\0')
+      break;
+    if (draw)
+      drw_setscheme(drw, scheme[ctmp - 11]);
+    tp = ++ts;
+  }
+  return x;
 }
 
 int
 main(int argc, char *argv[])
 {
-  if (argc == 2 && !strcmp("-v", argv[1]))
-    die("dwm-"VERSION);
-  else if (argc != 1)
-    die("usage: dwm [-v]");
+  int i;
+
+  for (i = 1; i < argc; i++)
+    if (!strcmp("-v", argv[i]))
+      die("dwm-"VERSION);
+    else if (!strcmp("-t", argv[i]) && i + 1 < argc) {
+      if (!(trace = fopen(argv[++i], "w"))
+          || fcntl(fileno(trace), F_SETFD, FD_CLOEXEC) == -1)
+        die("dwm: cannot open trace %s:", argv[i]);
+    } else
+      die("usage: dwm [-v] [-t file]");
   if (!setlocale(LC_CTYPE, "") || !XSupportsLocale())
     fputs("warning: no locale support\n", stderr);
   if (!(dpy = XOpenDisplay(NULL)))
@@ -3245,14 +4794,14 @@ main(int argc, char *argv[])
   XrmInitialize();
   loadxresources();
   setup();
-#ifdef __OpenBSD__
-  if (pledge("stdio rpath proc exec ps", NULL) == -1)
-    die("pledge");
-#endif /* __OpenBSD__ */
   scan();
+  if (trace)
+    tracescan();
   startdsblocks();
   run();
   cleanup();
+  if (trace)
+    fclose(trace);
   XCloseDisplay(dpy);
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,116 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * dwmc sends commands to the control socket of a running dwm:
+ *
+ *     dwmc view 4 setmfact 0.05 zoom
+ *
+ * All commands go out in one message and are run in order. A command takes
+ * the argument that follows it unless that is a command name itself, and dwm
+ * reads it as the type the command takes:
+ *
+ *     dwmc status "3 $(date +%R)"
+ *
+ * The commands are the names in signals[] of config.h.
+ */
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "ipc.h"
+#include "util.h"
+
+#define LENGTH(X)               (sizeof X / sizeof X[0])
+
+static const char *status[] = {
+	[IpcOk]        = "ok",
+	[IpcUnknown]   = "unknown command",
+	[IpcBadArg]    = "bad argument",
+	[IpcMalformed] = "malformed message",
+};
+
+/* command names are C identifiers, anything else is an argument */
+static int
+isname(const char *s)
+{
+	if (!isalpha((unsigned char)*s) && *s != '_')
+		return 0;
+	while (isalnum((unsigned char)*s) || *s == '_')
+		s++;
+	return !*s;
+}
+
+static size_t
+pack(unsigned char *msg, size_t off, const char *name, const char *arg)
+{
+	IpcCmd cmd = { IpcArgNone, strlen(name), 0 };
+
+	if (strlen(name) > UINT8_MAX)
+		die("dwmc: command too long: %s", name);
+	if (arg) {
+		if (strlen(arg) > IPCMSGSIZE)
+			die("dwmc: argument too long");
+		cmd.argtype = IpcArgText;
+		cmd.arglen = strlen(arg);
+	}
+	if (off + sizeof cmd + cmd.namelen + cmd.arglen > IPCMSGSIZE)
+		die("dwmc: too many commands");
+	memcpy(msg + off, &cmd, sizeof cmd);
+	off += sizeof cmd;
+	memcpy(msg + off, name, cmd.namelen);
+	off += cmd.namelen;
+	if (arg)
+		memcpy(msg + off, arg, cmd.arglen);
+	return off + cmd.arglen;
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	unsigned char msg[IPCMSGSIZE], reply[IPCMSGSIZE / sizeof(IpcCmd)];
+	const char *display = getenv("DISPLAY"), *names[IPCMSGSIZE / sizeof(IpcCmd)];
+	unsigned int n = 0;
+	size_t len = 0;
+	ssize_t r;
+	int i, fd, ret = EXIT_SUCCESS;
+
+	if (argc < 2 || !isname(argv[1]))
+		die("usage: dwmc command [argument] [command [argument]]...");
+	for (i = 1; i < argc; i++) {
+		names[n++] = argv[i];
+		if (i + 1 < argc && !isname(argv[i + 1])) {
+			len = pack(msg, len, argv[i], argv[i + 1]);
+			i++;
+		} else
+			len = pack(msg, len, argv[i], NULL);
+	}
+
+	if ((size_t)snprintf(addr.sun_path, sizeof addr.sun_path, IPCPATH,
+	    IPCDIR, display ? display : "") >= sizeof addr.sun_path)
+		die("dwmc: socket path too long");
+	if ((fd = socket(AF_UNIX, SOCK_SEQPACKET, 0)) == -1)
+		die("dwmc: socket:");
+	if (connect(fd, (struct sockaddr *)&addr, sizeof addr) == -1)
+		die("dwmc: cannot connect to %s:", addr.sun_path);
+	if (send(fd, msg, len, 0) != (ssize_t)len)
+		die("dwmc: send:");
+	if ((r = recv(fd, reply, sizeof reply, 0)) == -1)
+		die("dwmc: recv:");
+	close(fd);
+
+	for (i = 0; i < (int)n; i++) {
+		if (i >= r)
+			die("dwmc: no reply for %s", names[i]);
+		if (reply[i] != IpcOk) {
+			fprintf(stderr, "dwmc: %s: %s\n", names[i],
+			        reply[i] < LENGTH(status) ? status[reply[i]] : "error");
+			ret = EXIT_FAILURE;
+		}
+	}
+	return ret;
+}
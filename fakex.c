@@ -0,0 +1,1352 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * An in-memory X server for driving dwm without a display. It is linked
+ * in place of libX11, libxcb and drw.c and implements exactly the calls dwm
+ * makes: windows keep their geometry, map state and properties so that
+ * replies look like the real thing, events are only those queued with
+ * fakex_event(), and every request is counted per call.
+ *
+ * A request that has to wait for a reply counts as a round trip unless an
+ * earlier round trip already flushed it, which is how both Xlib and xcb
+ * behave when replies are collected after a batch of requests.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xresource.h>
+#include <X11/Xutil.h>
+#include <X11/Xlib-xcb.h>
+#include <X11/Xft/Xft.h>
+#include <xcb/res.h>
+#ifdef XINERAMA
+#include <X11/extensions/Xinerama.h>
+#endif /* XINERAMA */
+
+#include "drw.h"
+#include "fakex.h"
+#include "util.h"
+
+#define WINBASE    0x200000
+#define ATOMBASE   (XA_LAST_PREDEFINED + 1)
+#define PENDING    (1 << 18) /* outstanding xcb replies */
+#define SCREENW    3840
+#define SCREENH    2160
+#define FONTH      16
+#define CHARW      8
+#define LENGTH(X)  (sizeof X / sizeof X[0])
+
+#define REQUEST()  do { static Counter ctr; request(&ctr, __func__); } while (0)
+#define ROUNDTRIP() do { static Counter ctr; request(&ctr, __func__); await(&ctr, seq); } while (0)
+
+typedef struct Counter Counter;
+struct Counter {
+	const char *name;
+	unsigned long n, rt;
+	int listed;
+	Counter *next;
+};
+
+typedef struct {
+	Atom atom, type;
+	int format;
+	unsigned int len; /* in bytes, as sent over the wire */
+	unsigned char *data;
+} Prop;
+
+typedef struct {
+	int exists, mapped, override;
+	int x, y, w, h, bw;
+	Prop *props;
+	unsigned int nprops;
+} Win;
+
+enum { ReplyAttributes, ReplyGeometry, ReplyProperty, ReplyClientIds };
+
+typedef struct {
+	int kind;
+	Counter *ctr;
+	Window win;
+	Atom prop, type;
+	uint32_t len;
+} Pending;
+
+static Counter *counters;
+static unsigned long seq, synced, nrequests, nroundtrips;
+static Win *wins;
+static unsigned int nwins, winssize;
+static char **atoms;
+static unsigned int natoms;
+static XEvent *queue;
+static unsigned int qhead, qlen, qsize;
+static Pending pending[PENDING];
+static XID nextxid = 1;
+static KeySym keymap[256];
+static unsigned int nkeys = 8;
+static _XPrivDisplay display;
+
+static void
+request(Counter *c, const char *name)
+{
+	if (!c->listed) {
+		c->name = name;
+		c->listed = 1;
+		c->next = counters;
+		counters = c;
+	}
+	c->n++;
+	seq++;
+	nrequests++;
+}
+
+/* wait for the reply to request s */
+static void
+await(Counter *c, unsigned long s)
+{
+	if (s <= synced)
+		return;
+	c->rt++;
+	nroundtrips++;
+	synced = seq;
+}
+
+static Win *
+getwin(Window w)
+{
+	if (w < WINBASE || w - WINBASE >= nwins || !wins[w - WINBASE].exists)
+		return NULL;
+	return &wins[w - WINBASE];
+}
+
+static Window
+createwin(int x, int y, unsigned int w, unsigned int h, unsigned int bw)
+{
+	Win *win;
+
+	if (nwins == winssize) {
+		winssize = winssize ? winssize * 2 : 256;
+		if (!(wins = realloc(wins, winssize * sizeof(Win))))
+			die("fakex: realloc:");
+	}
+	win = &wins[nwins];
+	memset(win, 0, sizeof(Win));
+	win->exists = 1;
+	win->x = x;
+	win->y = y;
+	win->w = w;
+	win->h = h;
+	win->bw = bw;
+	return WINBASE + nwins++;
+}
+
+static Prop *
+getprop(Win *w, Atom atom)
+{
+	unsigned int i;
+
+	for (i = 0; i < w->nprops; i++)
+		if (w->props[i].atom == atom)
+			return &w->props[i];
+	return NULL;
+}
+
+static void
+setprop(Window w, Atom atom, Atom type, int format, int mode, const void *data, int n)
+{
+	unsigned int i, size = format / 8, len = n * size;
+	unsigned char *buf, *v;
+	Prop *p;
+	Win *win;
+
+	if (!(win = getwin(w)))
+		return;
+	if (!(p = getprop(win, atom))) {
+		if (!(win->props = realloc(win->props, (win->nprops + 1) * sizeof(Prop))))
+			die("fakex: realloc:");
+		p = &win->props[win->nprops++];
+		memset(p, 0, sizeof(Prop));
+		p->atom = atom;
+		mode = PropModeReplace;
+	}
+	if (mode == PropModeReplace)
+		p->len = 0;
+	buf = ecalloc(1, p->len + len + 1);
+	v = buf + (mode == PropModePrepend ? 0 : p->len);
+	/* format 32 data comes in as longs but travels as 32 bit words */
+	if (format == 32)
+		for (i = 0; i < (unsigned int)n; i++)
+			((uint32_t *)v)[i] = ((const long *)data)[i];
+	else
+		memcpy(v, data, len);
+	if (p->len)
+		memcpy(buf + (mode == PropModePrepend ? len : 0), p->data, p->len);
+	free(p->data);
+	p->data = buf;
+	p->len += len;
+	p->type = type;
+	p->format = format;
+}
+
+static Atom
+getatom(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < natoms; i++)
+		if (!strcmp(atoms[i], name))
+			return ATOMBASE + i;
+	if (!(atoms = realloc(atoms, (natoms + 1) * sizeof(char *))))
+		die("fakex: realloc:");
+	atoms[natoms] = ecalloc(1, strlen(name) + 1);
+	strcpy(atoms[natoms], name);
+	return ATOMBASE + natoms++;
+}
+
+static long
+evmask(int type)
+{
+	switch (type) {
+	case KeyPress:         return KeyPressMask;
+	case ButtonPress:      return ButtonPressMask;
+	case ButtonRelease:    return ButtonReleaseMask;
+	case MotionNotify:     return PointerMotionMask;
+	case EnterNotify:      return EnterWindowMask;
+	case LeaveNotify:      return LeaveWindowMask;
+	case Expose:           return ExposureMask;
+	case ConfigureRequest:
+	case MapRequest:       return SubstructureRedirectMask;
+	case PropertyNotify:   return PropertyChangeMask;
+	}
+	return NoEventMask;
+}
+
+static int
+dequeue(long mask, XEvent *ev)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < qlen; i++) {
+		j = (qhead + i) % qsize;
+		if (mask && !(evmask(queue[j].type) & mask))
+			continue;
+		*ev = queue[j];
+		/* close the gap, keeping the remaining events in order */
+		for (; i > 0; i--)
+			queue[(qhead + i) % qsize] = queue[(qhead + i - 1) % qsize];
+		qhead = (qhead + 1) % qsize;
+		qlen--;
+		return 1;
+	}
+	return 0;
+}
+
+Window
+fakex_window(int x, int y, unsigned int w, unsigned int h, int mapped)
+{
+	Window win = createwin(x, y, w, h, 0);
+
+	getwin(win)->mapped = mapped;
+	return win;
+}
+
+/* a window looking like a terminal */
+Window
+fakex_client(const char *name, int mapped)
+{
+	static const char class[] = "st\0St";
+	static const long hints[9] = { InputHint, True };
+	Window w = fakex_window(0, 0, 640, 480, mapped);
+
+	setprop(w, XA_WM_CLASS, XA_STRING, 8, PropModeReplace, class, sizeof class);
+	setprop(w, XA_WM_HINTS, XA_WM_HINTS, 32, PropModeReplace, hints, LENGTH(hints));
+	fakex_setname(w, name);
+	return w;
+}
+
+void
+fakex_setname(Window w, const char *name)
+{
+	setprop(w, XA_WM_NAME, XA_STRING, 8, PropModeReplace, name, strlen(name));
+	setprop(w, getatom("_NET_WM_NAME"), getatom("UTF8_STRING"), 8, PropModeReplace,
+	        name, strlen(name));
+}
+
+void
+fakex_destroy(Window w)
+{
+	unsigned int i;
+	Win *win;
+
+	if (!(win = getwin(w)))
+		return;
+	for (i = 0; i < win->nprops; i++)
+		free(win->props[i].data);
+	free(win->props);
+	memset(win, 0, sizeof(Win));
+}
+
+void
+fakex_setprop(Window w, Atom prop, Atom type, int format, const void *data, int n)
+{
+	setprop(w, prop, type, format, PropModeReplace, data, n);
+}
+
+void
+fakex_event(XEvent *ev)
+{
+	if (qlen == qsize) {
+		XEvent *q = ecalloc(qsize ? qsize * 2 : 256, sizeof(XEvent));
+		unsigned int i;
+
+		for (i = 0; i < qlen; i++)
+			q[i] = queue[(qhead + i) % qsize];
+		free(queue);
+		queue = q;
+		qhead = 0;
+		qsize = qsize ? qsize * 2 : 256;
+	}
+	ev->xany.display = (Display *)display;
+	ev->xany.serial = seq;
+	queue[(qhead + qlen++) % qsize] = *ev;
+}
+
+void
+fakex_reset(void)
+{
+	Counter *c;
+
+	for (c = counters; c; c = c->next)
+		c->n = c->rt = 0;
+	nrequests = nroundtrips = 0;
+	synced = seq;
+}
+
+unsigned long
+fakex_requests(void)
+{
+	return nrequests;
+}
+
+unsigned long
+fakex_roundtrips(void)
+{
+	return nroundtrips;
+}
+
+void
+fakex_report(FILE *f, unsigned long ops)
+{
+	Counter *c;
+
+	for (c = counters; c; c = c->next)
+		if (c->n)
+			fprintf(f, "\t%-36s %10.3f requests/op %8.3f round trips/op\n",
+			        c->name, (double)c->n / ops, (double)c->rt / ops);
+}
+
+/* Xlib */
+
+Display *
+XOpenDisplay(const char *name)
+{
+	int fds[2];
+	Screen *s;
+
+	if (pipe(fds) == -1)
+		die("fakex: pipe:");
+	display = ecalloc(1, sizeof(*display));
+	display->fd = fds[0];
+	display->default_screen = 0;
+	display->nscreens = 1;
+	display->screens = s = ecalloc(1, sizeof(Screen));
+	s->display = (Display *)display;
+	s->root = createwin(0, 0, SCREENW, SCREENH, 0);
+	getwin(s->root)->mapped = 1;
+	s->width = SCREENW;
+	s->height = SCREENH;
+	s->root_depth = 24;
+	s->root_visual = ecalloc(1, sizeof(Visual));
+	s->cmap = nextxid++;
+	return (Display *)display;
+}
+
+int
+XCloseDisplay(Display *dpy)
+{
+	unsigned int i;
+
+	for (i = 0; i < nwins; i++)
+		fakex_destroy(WINBASE + i);
+	free(wins);
+	for (i = 0; i < natoms; i++)
+		free(atoms[i]);
+	free(atoms);
+	free(queue);
+	close(display->fd);
+	free(display->screens->root_visual);
+	free(display->screens);
+	free(display);
+	return 0;
+}
+
+xcb_connection_t *
+XGetXCBConnection(Display *dpy)
+{
+	return (xcb_connection_t *)dpy;
+}
+
+Bool
+XSupportsLocale(void)
+{
+	return True;
+}
+
+XErrorHandler
+XSetErrorHandler(XErrorHandler handler)
+{
+	return NULL;
+}
+
+void
+XrmInitialize(void)
+{
+}
+
+char *
+XResourceManagerString(Display *dpy)
+{
+	return NULL;
+}
+
+XrmDatabase
+XrmGetStringDatabase(const char *data)
+{
+	return NULL;
+}
+
+Bool
+XrmGetResource(XrmDatabase db, const char *name, const char *class, char **type, XrmValue *value)
+{
+	return False;
+}
+
+int
+XFree(void *data)
+{
+	free(data);
+	return 1;
+}
+
+int
+XFlush(Display *dpy)
+{
+	return 1;
+}
+
+int
+XSync(Display *dpy, Bool discard)
+{
+	ROUNDTRIP();
+	if (discard)
+		qlen = 0;
+	return 1;
+}
+
+unsigned long
+XNextRequest(Display *dpy)
+{
+	return seq + 1;
+}
+
+int
+XPending(Display *dpy)
+{
+	return qlen;
+}
+
+int
+XEventsQueued(Display *dpy, int mode)
+{
+	return qlen;
+}
+
+int
+XQLength(Display *dpy)
+{
+	return qlen;
+}
+
+int
+XNextEvent(Display *dpy, XEvent *ev)
+{
+	if (!dequeue(0, ev))
+		die("fakex: XNextEvent would block");
+	return 0;
+}
+
+int
+XMaskEvent(Display *dpy, long mask, XEvent *ev)
+{
+	if (!dequeue(mask, ev))
+		die("fakex: XMaskEvent would block");
+	return 0;
+}
+
+Bool
+XCheckMaskEvent(Display *dpy, long mask, XEvent *ev)
+{
+	return dequeue(mask, ev);
+}
+
+Atom
+XInternAtom(Display *dpy, const char *name, Bool onlyifexists)
+{
+	ROUNDTRIP();
+	return getatom(name);
+}
+
+Window
+XCreateSimpleWindow(Display *dpy, Window parent, int x, int y, unsigned int w,
+                    unsigned int h, unsigned int bw, unsigned long border, unsigned long bg)
+{
+	REQUEST();
+	return createwin(x, y, w, h, bw);
+}
+
+Window
+XCreateWindow(Display *dpy, Window parent, int x, int y, unsigned int w, unsigned int h,
+              unsigned int bw, int depth, unsigned int class, Visual *visual,
+              unsigned long mask, XSetWindowAttributes *wa)
+{
+	Window win;
+
+	REQUEST();
+	win = createwin(x, y, w, h, bw);
+	if (mask & CWOverrideRedirect)
+		getwin(win)->override = wa->override_redirect;
+	return win;
+}
+
+int
+XDestroyWindow(Display *dpy, Window w)
+{
+	REQUEST();
+	fakex_destroy(w);
+	return 1;
+}
+
+Colormap
+XCreateColormap(Display *dpy, Window w, Visual *visual, int alloc)
+{
+	REQUEST();
+	return nextxid++;
+}
+
+int
+XChangeWindowAttributes(Display *dpy, Window w, unsigned long mask, XSetWindowAttributes *wa)
+{
+	Win *win;
+
+	REQUEST();
+	if ((mask & CWOverrideRedirect) && (win = getwin(w)))
+		win->override = wa->override_redirect;
+	return 1;
+}
+
+int
+XSelectInput(Display *dpy, Window w, long mask)
+{
+	REQUEST();
+	return 1;
+}
+
+int
+XDefineCursor(Display *dpy, Window w, Cursor cursor)
+{
+	REQUEST();
+	return 1;
+}
+
+int
+XSetClassHint(Display *dpy, Window w, XClassHint *ch)
+{
+	REQUEST();
+	return 1;
+}
+
+int
+XSetWindowBorder(Display *dpy, Window w, unsigned long pixel)
+{
+	REQUEST();
+	return 1;
+}
+
+int
+XMapWindow(Display *dpy, Window w)
+{
+	Win *win;
+
+	REQUEST();
+	if ((win = getwin(w)))
+		win->mapped = 1;
+	return 1;
+}
+
+int
+XMapRaised(Display *dpy, Window w)
+{
+	Win *win;
+
+	REQUEST();
+	if ((win = getwin(w)))
+		win->mapped = 1;
+	return 1;
+}
+
+int
+XUnmapWindow(Display *dpy, Window w)
+{
+	Win *win;
+
+	REQUEST();
+	if ((win = getwin(w)))
+		win->mapped = 0;
+	return 1;
+}
+
+int
+XRaiseWindow(Display *dpy, Window w)
+{
+	REQUEST();
+	return 1;
+}
+
+int
+XConfigureWindow(Display *dpy, Window w, unsigned int mask, XWindowChanges *wc)
+{
+	Win *win;
+
+	REQUEST();
+	if (!(win = getwin(w)))
+		return 1;
+	if (mask & CWX)
+		win->x = wc->x;
+	if (mask & CWY)
+		win->y = wc->y;
+	if (mask & CWWidth)
+		win->w = wc->width;
+	if (mask & CWHeight)
+		win->h = wc->height;
+	if (mask & CWBorderWidth)
+		win->bw = wc->border_width;
+	return 1;
+}
+
+int
+XMoveWindow(Display *dpy, Window w, int x, int y)
+{
+	Win *win;
+
+	REQUEST();
+	if ((win = getwin(w))) {
+		win->x = x;
+		win->y = y;
+	}
+	return 1;
+}
+
+int
+XMoveResizeWindow(Display *dpy, Window w, int x, int y, unsigned int width, unsigned int height)
+{
+	Win *win;
+
+	REQUEST();
+	if ((win = getwin(w))) {
+		win->x = x;
+		win->y = y;
+		win->w = width;
+		win->h = height;
+	}
+	return 1;
+}
+
+int
+XChangeProperty(Display *dpy, Window w, Atom prop, Atom type, int format, int mode,
+                const unsigned char *data, int n)
+{
+	REQUEST();
+	setprop(w, prop, type, format, mode, data, n);
+	return 1;
+}
+
+int
+XDeleteProperty(Display *dpy, Window w, Atom prop)
+{
+	Prop *p;
+	Win *win;
+
+	REQUEST();
+	if ((win = getwin(w)) && (p = getprop(win, prop))) {
+		free(p->data);
+		*p = win->props[--win->nprops];
+	}
+	return 1;
+}
+
+XWMHints *
+XGetWMHints(Display *dpy, Window w)
+{
+	XWMHints *wmh;
+	uint32_t *v;
+	Prop *p;
+	Win *win;
+
+	ROUNDTRIP();
+	if (!(win = getwin(w)) || !(p = getprop(win, XA_WM_HINTS)) || p->len < 9 * 4)
+		return NULL;
+	v = (uint32_t *)p->data;
+	wmh = ecalloc(1, sizeof(XWMHints));
+	wmh->flags = v[0];
+	wmh->input = v[1];
+	wmh->initial_state = v[2];
+	wmh->icon_pixmap = v[3];
+	wmh->icon_window = v[4];
+	wmh->icon_x = v[5];
+	wmh->icon_y = v[6];
+	wmh->icon_mask = v[7];
+	wmh->window_group = v[8];
+	return wmh;
+}
+
+int
+XSetWMHints(Display *dpy, Window w, XWMHints *wmh)
+{
+	long v[9];
+
+	REQUEST();
+	v[0] = wmh->flags;
+	v[1] = wmh->input;
+	v[2] = wmh->initial_state;
+	v[3] = wmh->icon_pixmap;
+	v[4] = wmh->icon_window;
+	v[5] = wmh->icon_x;
+	v[6] = wmh->icon_y;
+	v[7] = wmh->icon_mask;
+	v[8] = wmh->window_group;
+	setprop(w, XA_WM_HINTS, XA_WM_HINTS, 32, PropModeReplace, v, 9);
+	return 1;
+}
+
+Status
+XGetWMProtocols(Display *dpy, Window w, Atom **protocols, int *n)
+{
+	unsigned int i;
+	Prop *p;
+	Win *win;
+
+	ROUNDTRIP();
+	if (!(win = getwin(w)) || !(p = getprop(win, getatom("WM_PROTOCOLS"))) || !p->len)
+		return 0;
+	*n = p->len / 4;
+	*protocols = ecalloc(*n, sizeof(Atom));
+	for (i = 0; i < (unsigned int)*n; i++)
+		(*protocols)[i] = ((uint32_t *)p->data)[i];
+	return 1;
+}
+
+int
+XmbTextPropertyToTextList(Display *dpy, const XTextProperty *tp, char ***list, int *count)
+{
+	char **l;
+
+	/* a single string, allocated in one block like Xlib does */
+	l = ecalloc(1, sizeof(char *) + tp->nitems + 1);
+	l[0] = (char *)(l + 1);
+	memcpy(l[0], tp->value, tp->nitems);
+	*list = l;
+	*count = 1;
+	return Success;
+}
+
+void
+XFreeStringList(char **list)
+{
+	free(list);
+}
+
+Status
+XQueryTree(Display *dpy, Window w, Window *root, Window *parent, Window **children,
+           unsigned int *n)
+{
+	unsigned int i;
+
+	ROUNDTRIP();
+	*root = display->screens->root;
+	*parent = None;
+	*children = ecalloc(nwins, sizeof(Window));
+	for (*n = 0, i = 0; i < nwins; i++)
+		if (wins[i].exists && WINBASE + i != display->screens->root)
+			(*children)[(*n)++] = WINBASE + i;
+	return 1;
+}
+
+Bool
+XQueryPointer(Display *dpy, Window w, Window *root, Window *child, int *rx, int *ry,
+              int *x, int *y, unsigned int *mask)
+{
+	ROUNDTRIP();
+	*root = display->screens->root;
+	*child = None;
+	*rx = *ry = *x = *y = 0;
+	*mask = 0;
+	return True;
+}
+
+int
+XWarpPointer(Display *dpy, Window src, Window dst, int sx, int sy, unsigned int sw,
+             unsigned int sh, int dx, int dy)
+{
+	REQUEST();
+	return 1;
+}
+
+int
+XSetInputFocus(Display *dpy, Window w, int revert, Time time)
+{
+	REQUEST();
+	return 1;
+}
+
+Status
+XSendEvent(Display *dpy, Window w, Bool propagate, long mask, XEvent *ev)
+{
+	REQUEST();
+	return 1;
+}
+
+int
+XKillClient(Display *dpy, XID id)
+{
+	REQUEST();
+	fakex_destroy(id);
+	return 1;
+}
+
+int
+XSetCloseDownMode(Display *dpy, int mode)
+{
+	REQUEST();
+	return 1;
+}
+
+int
+XGrabServer(Display *dpy)
+{
+	REQUEST();
+	return 1;
+}
+
+int
+XUngrabServer(Display *dpy)
+{
+	REQUEST();
+	return 1;
+}
+
+int
+XGrabPointer(Display *dpy, Window w, Bool owner, unsigned int mask, int pmode, int kmode,
+             Window confine, Cursor cursor, Time time)
+{
+	ROUNDTRIP();
+	return GrabSuccess;
+}
+
+int
+XUngrabPointer(Display *dpy, Time time)
+{
+	REQUEST();
+	return 1;
+}
+
+int
+XAllowEvents(Display *dpy, int mode, Time time)
+{
+	REQUEST();
+	return 1;
+}
+
+int
+XGrabButton(Display *dpy, unsigned int button, unsigned int mod, Window w, Bool owner,
+            unsigned int mask, int pmode, int kmode, Window confine, Cursor cursor)
+{
+	REQUEST();
+	return 1;
+}
+
+int
+XUngrabButton(Display *dpy, unsigned int button, unsigned int mod, Window w)
+{
+	REQUEST();
+	return 1;
+}
+
+int
+XGrabKey(Display *dpy, int keycode, unsigned int mod, Window w, Bool owner, int pmode, int kmode)
+{
+	REQUEST();
+	return 1;
+}
+
+int
+XUngrabKey(Display *dpy, int keycode, unsigned int mod, Window w)
+{
+	REQUEST();
+	return 1;
+}
+
+XModifierKeymap *
+XGetModifierMapping(Display *dpy)
+{
+	XModifierKeymap *map;
+
+	ROUNDTRIP();
+	map = ecalloc(1, sizeof(XModifierKeymap));
+	map->max_keypermod = 1;
+	map->modifiermap = ecalloc(8, sizeof(KeyCode));
+	return map;
+}
+
+int
+XFreeModifiermap(XModifierKeymap *map)
+{
+	free(map->modifiermap);
+	free(map);
+	return 1;
+}
+
+int
+XRefreshKeyboardMapping(XMappingEvent *ev)
+{
+	return 1;
+}
+
+/* keycodes are handed out as keysyms are first asked for */
+KeyCode
+XKeysymToKeycode(Display *dpy, KeySym keysym)
+{
+	unsigned int i;
+
+	for (i = 8; i < nkeys; i++)
+		if (keymap[i] == keysym)
+			return i;
+	if (nkeys == LENGTH(keymap))
+		return 0;
+	keymap[nkeys] = keysym;
+	return nkeys++;
+}
+
+KeySym
+XKeycodeToKeysym(Display *dpy, KeyCode keycode, int index)
+{
+	return keymap[keycode];
+}
+
+char *
+XKeysymToString(KeySym keysym)
+{
+	return NULL;
+}
+
+XVisualInfo *
+XGetVisualInfo(Display *dpy, long mask, XVisualInfo *tpl, int *n)
+{
+	*n = 0;
+	return NULL;
+}
+
+XRenderPictFormat *
+XRenderFindVisualFormat(Display *dpy, const Visual *visual)
+{
+	return NULL;
+}
+
+#ifdef XINERAMA
+Bool
+XineramaIsActive(Display *dpy)
+{
+	return False;
+}
+
+XineramaScreenInfo *
+XineramaQueryScreens(Display *dpy, int *n)
+{
+	*n = 0;
+	return NULL;
+}
+#endif /* XINERAMA */
+
+/* xcb, replies are built from the state at the time they are collected */
+
+static unsigned int
+queue_reply(Counter *c, int kind, Window w, Atom prop, Atom type, uint32_t len)
+{
+	Pending *p;
+
+	request(c, c->name);
+	p = &pending[seq % PENDING];
+	p->kind = kind;
+	p->ctr = c;
+	p->win = w;
+	p->prop = prop;
+	p->type = type;
+	p->len = len;
+	return seq;
+}
+
+static Pending *
+reply(unsigned int sequence, xcb_generic_error_t **e)
+{
+	Pending *p = &pending[sequence % PENDING];
+
+	if (e)
+		*e = NULL;
+	await(p->ctr, sequence);
+	return p;
+}
+
+void
+xcb_discard_reply(xcb_connection_t *c, unsigned int sequence)
+{
+}
+
+xcb_get_window_attributes_cookie_t
+xcb_get_window_attributes(xcb_connection_t *c, xcb_window_t w)
+{
+	static Counter ctr = { "xcb_get_window_attributes" };
+	xcb_get_window_attributes_cookie_t ck;
+
+	ck.sequence = queue_reply(&ctr, ReplyAttributes, w, None, None, 0);
+	return ck;
+}
+
+xcb_get_window_attributes_reply_t *
+xcb_get_window_attributes_reply(xcb_connection_t *c, xcb_get_window_attributes_cookie_t ck,
+                                xcb_generic_error_t **e)
+{
+	xcb_get_window_attributes_reply_t *r;
+	Pending *p = reply(ck.sequence, e);
+	Win *win;
+
+	if (!(win = getwin(p->win)))
+		return NULL;
+	r = ecalloc(1, sizeof(*r));
+	r->_class = XCB_WINDOW_CLASS_INPUT_OUTPUT;
+	r->map_state = win->mapped ? XCB_MAP_STATE_VIEWABLE : XCB_MAP_STATE_UNMAPPED;
+	r->override_redirect = win->override;
+	return r;
+}
+
+xcb_get_geometry_cookie_t
+xcb_get_geometry(xcb_connection_t *c, xcb_drawable_t d)
+{
+	static Counter ctr = { "xcb_get_geometry" };
+	xcb_get_geometry_cookie_t ck;
+
+	ck.sequence = queue_reply(&ctr, ReplyGeometry, d, None, None, 0);
+	return ck;
+}
+
+xcb_get_geometry_reply_t *
+xcb_get_geometry_reply(xcb_connection_t *c, xcb_get_geometry_cookie_t ck,
+                       xcb_generic_error_t **e)
+{
+	xcb_get_geometry_reply_t *r;
+	Pending *p = reply(ck.sequence, e);
+	Win *win;
+
+	if (!(win = getwin(p->win)))
+		return NULL;
+	r = ecalloc(1, sizeof(*r));
+	r->root = display->screens->root;
+	r->depth = 24;
+	r->x = win->x;
+	r->y = win->y;
+	r->width = win->w;
+	r->height = win->h;
+	r->border_width = win->bw;
+	return r;
+}
+
+xcb_get_property_cookie_t
+xcb_get_property(xcb_connection_t *c, uint8_t del, xcb_window_t w, xcb_atom_t prop,
+                 xcb_atom_t type, uint32_t offset, uint32_t len)
+{
+	static Counter ctr = { "xcb_get_property" };
+	xcb_get_property_cookie_t ck;
+
+	ck.sequence = queue_reply(&ctr, ReplyProperty, w, prop, type, len);
+	return ck;
+}
+
+xcb_get_property_reply_t *
+xcb_get_property_reply(xcb_connection_t *c, xcb_get_property_cookie_t ck,
+                       xcb_generic_error_t **e)
+{
+	xcb_get_property_reply_t *r;
+	Pending *pd = reply(ck.sequence, e);
+	unsigned int n = 0;
+	Prop *p = NULL;
+	Win *win;
+
+	if (!(win = getwin(pd->win)))
+		return NULL;
+	p = getprop(win, pd->prop);
+	if (p && (pd->type == AnyPropertyType || pd->type == p->type))
+		n = MIN(p->len, pd->len * 4);
+	r = ecalloc(1, sizeof(*r) + n);
+	if (p) {
+		r->type = p->type;
+		r->format = p->format;
+		r->bytes_after = p->len - n;
+		r->value_len = n / (p->format / 8);
+		memcpy(r + 1, p->data, n);
+	}
+	return r;
+}
+
+void *
+xcb_get_property_value(const xcb_get_property_reply_t *r)
+{
+	return (void *)(r + 1);
+}
+
+int
+xcb_get_property_value_length(const xcb_get_property_reply_t *r)
+{
+	return r->value_len * (r->format / 8);
+}
+
+/* no pid is known for any window */
+xcb_res_query_client_ids_cookie_t
+xcb_res_query_client_ids(xcb_connection_t *c, uint32_t n, const xcb_res_client_id_spec_t *specs)
+{
+	static Counter ctr = { "xcb_res_query_client_ids" };
+	xcb_res_query_client_ids_cookie_t ck;
+
+	ck.sequence = queue_reply(&ctr, ReplyClientIds, specs->client, None, None, 0);
+	return ck;
+}
+
+xcb_res_query_client_ids_reply_t *
+xcb_res_query_client_ids_reply(xcb_connection_t *c, xcb_res_query_client_ids_cookie_t ck,
+                               xcb_generic_error_t **e)
+{
+	reply(ck.sequence, e);
+	return ecalloc(1, sizeof(xcb_res_query_client_ids_reply_t));
+}
+
+xcb_res_client_id_value_iterator_t
+xcb_res_query_client_ids_ids_iterator(const xcb_res_query_client_ids_reply_t *r)
+{
+	xcb_res_client_id_value_iterator_t i;
+
+	memset(&i, 0, sizeof(i));
+	return i;
+}
+
+void
+xcb_res_client_id_value_next(xcb_res_client_id_value_iterator_t *i)
+{
+	i->rem = 0;
+}
+
+uint32_t *
+xcb_res_client_id_value_value(const xcb_res_client_id_value_t *v)
+{
+	return NULL;
+}
+
+/* drw, every glyph is CHARW wide and nothing is rasterized */
+
+/* drawing is queued as in drw.c, a run of one kind and scheme color costs a
+ * request when flushed and rectangles one more to set the foreground */
+static struct { int kind; const Clr *clr; unsigned int nops; unsigned long requests; } batch;
+
+static void
+batch_flush(Drw *drw)
+{
+	for (; batch.requests; batch.requests--)
+		REQUEST();
+	batch.nops = 0;
+}
+
+static void
+batch_add(Drw *drw, int kind, const Clr *clr)
+{
+	if (batch.nops && batch.kind == kind && batch.clr == clr)
+		return;
+	if (batch.nops == BATCHOPS)
+		batch_flush(drw);
+	batch.kind = kind;
+	batch.clr = clr;
+	batch.nops++;
+	batch.requests += kind == BatchGlyphs ? 1 : 2;
+}
+
+Drw *
+drw_create(Display *dpy, int screen, Window root, unsigned int w, unsigned int h,
+           Visual *visual, unsigned int depth, Colormap cmap)
+{
+	Drw *drw = ecalloc(1, sizeof(Drw));
+
+	REQUEST(); /* the backing pixmap */
+	drw->dpy = dpy;
+	drw->screen = screen;
+	drw->root = root;
+	drw->w = w;
+	drw->h = h;
+	drw->visual = visual;
+	drw->depth = depth;
+	drw->cmap = cmap;
+	drw->drawable = nextxid++;
+	return drw;
+}
+
+void
+drw_resize(Drw *drw, unsigned int w, unsigned int h)
+{
+	REQUEST();
+	batch.nops = batch.requests = 0; /* drawn into the old pixmap */
+	drw->w = w;
+	drw->h = h;
+}
+
+void
+drw_free(Drw *drw)
+{
+	free(drw->fonts);
+	free(drw);
+}
+
+Fnt *
+drw_fontset_create(Drw *drw, char fonts[])
+{
+	Fnt *f = ecalloc(1, sizeof(Fnt));
+
+	f->dpy = drw->dpy;
+	f->h = FONTH;
+	return drw->fonts = f;
+}
+
+unsigned int
+drw_fontset_getwidth(Drw *drw, const char *text)
+{
+	if (!drw || !drw->fonts || !text)
+		return 0;
+	return strlen(text) * CHARW;
+}
+
+/* segments are remembered by key only, a copy is one request like a draw */
+static struct { const char *text; unsigned int state, w, h; } segs[64];
+
+int
+drw_seg_copy(Drw *drw, const char *text, unsigned int state, int x, int y, unsigned int w, unsigned int h)
+{
+	unsigned int i;
+
+	for (i = 0; i < LENGTH(segs) && segs[i].text; i++)
+		if (!strcmp(segs[i].text, text) && segs[i].state == state && segs[i].w == w && segs[i].h == h) {
+			batch_flush(drw);
+			REQUEST();
+			return 1;
+		}
+	return 0;
+}
+
+void
+drw_seg_save(Drw *drw, const char *text, unsigned int state, int x, int y, unsigned int w, unsigned int h)
+{
+	static unsigned int next;
+	unsigned int i = next++ % LENGTH(segs);
+
+	REQUEST(); /* the pixmap */
+	batch_flush(drw);
+	REQUEST(); /* the copy into it */
+	free((char *)segs[i].text);
+	segs[i].text = strcpy(ecalloc(strlen(text) + 1, 1), text);
+	segs[i].state = state;
+	segs[i].w = w;
+	segs[i].h = h;
+}
+
+/* every glyph exists, there is nothing to fall back to */
+int
+drw_fallback_fd(Drw *drw)
+{
+	return -1;
+}
+
+int
+drw_fallback_load(Drw *drw)
+{
+	return 0;
+}
+
+Clr *
+drw_scm_create(Drw *drw, char *clrnames[], unsigned int alpha, size_t clrcount)
+{
+	return ecalloc(clrcount, sizeof(Clr));
+}
+
+Cur *
+drw_cur_create(Drw *drw, int shape)
+{
+	Cur *cur = ecalloc(1, sizeof(Cur));
+
+	cur->cursor = nextxid++;
+	return cur;
+}
+
+void
+drw_cur_free(Drw *drw, Cur *cursor)
+{
+	free(cursor);
+}
+
+void
+drw_setscheme(Drw *drw, Clr *scm)
+{
+	if (drw)
+		drw->scheme = scm;
+}
+
+void
+drw_rect(Drw *drw, int x, int y, unsigned int w, unsigned int h, int filled, int invert)
+{
+	if (!drw || !drw->scheme)
+		return;
+	batch_add(drw, filled ? BatchFill : BatchOutline, &drw->scheme[invert ? ColBg : ColFg]);
+}
+
+int
+drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned int lpad,
+         const char *text, int invert)
+{
+	if (!drw || !text)
+		return 0;
+	if (!x && !y && !w && !h)
+		return strlen(text) * CHARW;
+	batch_add(drw, BatchFill, &drw->scheme[invert ? ColFg : ColBg]);
+	batch_add(drw, BatchGlyphs, &drw->scheme[invert ? ColBg : ColFg]);
+	return x + w;
+}
+
+void
+drw_map(Drw *drw, Window win, int x, int y, unsigned int w, unsigned int h)
+{
+	batch_flush(drw);
+	REQUEST();
+}
@@ -0,0 +1,15 @@
+/* See LICENSE file for copyright and license details. */
+
+/* In-memory X server, linked in place of Xlib, xcb and drw.c */
+Window fakex_window(int x, int y, unsigned int w, unsigned int h, int mapped);
+Window fakex_client(const char *name, int mapped);
+void fakex_setname(Window w, const char *name);
+void fakex_destroy(Window w);
+void fakex_setprop(Window w, Atom prop, Atom type, int format, const void *data, int n);
+void fakex_event(XEvent *ev);
+
+/* Request accounting */
+void fakex_reset(void);
+unsigned long fakex_requests(void);
+unsigned long fakex_roundtrips(void);
+void fakex_report(FILE *f, unsigned long ops);
@@ -0,0 +1,21 @@
+/* See LICENSE file for copyright and license details. */
+
+/* Control socket shared by dwm and dwmc. A request is one packet on a
+ * SOCK_SEQPACKET socket holding any number of commands, each an IpcCmd
+ * followed by namelen bytes of command name and arglen bytes of argument.
+ * A string argument is not terminated. dwm answers with one packet holding
+ * an IpcStatus byte per command. */
+#define IPCPATH                 "%s/dwm%s.sock" /* formatted with IPCDIR and $DISPLAY */
+#define IPCDIR                  (getenv("XDG_RUNTIME_DIR") ? getenv("XDG_RUNTIME_DIR") : "/tmp")
+#define IPCMSGSIZE              4096
+
+/* IpcArgText is read by dwm as the argument type of the command, the others
+ * are passed on as they are */
+enum { IpcArgNone, IpcArgInt, IpcArgUint, IpcArgFloat, IpcArgString, IpcArgText }; /* argument types */
+enum { IpcOk, IpcUnknown, IpcBadArg, IpcMalformed };                   /* IpcStatus */
+
+typedef struct {
+	uint8_t argtype;
+	uint8_t namelen;
+	uint16_t arglen;
+} IpcCmd;
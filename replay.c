@@ -0,0 +1,267 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * Replays a trace recorded with dwm -t against the in-memory X server in
+ * fakex.c. The windows managed at startup are created and scanned, then
+ * every recorded event is dispatched through xevents() and runpending() as
+ * fast as possible, and the time and X requests spent on each event type
+ * are reported. Windows the trace refers to are created on first sight as
+ * synthetic terminals, commands sent over the control socket are run
+ * directly, and commands bound to spawn are not run.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define main dwmmain
+#define fork() 1
+#include "dwm.c"
+#undef fork
+#undef main
+
+#include "fakex.h"
+
+typedef struct {
+  long id;
+  Window win;
+} WinMap;
+
+typedef struct {
+  unsigned long n, requests, roundtrips;
+  unsigned long long t, max;
+} Stat;
+
+static Stat stats[TraceCommand + 1];
+static WinMap *winmap;
+static unsigned int nwinmap;
+static unsigned char *buf, *pos, *end;
+static unsigned long long span; /* recorded time in us */
+static unsigned long nstatus;
+
+static long
+get(void)
+{
+  unsigned long u = 0;
+  int shift = 0;
+
+  do {
+    if (pos == end)
+      die("replay: truncated trace");
+    u |= (unsigned long)(*pos & 0x7f) << shift;
+    shift += 7;
+  } while (*pos++ & 0x80);
+  return (long)(u >> 1) ^ -(long)(u & 1);
+}
+
+static Window
+getwin(long id, int mapped)
+{
+  char name[32];
+  unsigned int i;
+  Monitor *m;
+
+  if (id == 0)
+    return None;
+  if (id == 1)
+    return root;
+  for (m = mons; m; m = m->next)
+    if (id == 2 + m->num)
+      return m->barwin;
+  for (i = 0; i < nwinmap; i++)
+    if (winmap[i].id == id)
+      return winmap[i].win;
+  if (!(winmap = realloc(winmap, (nwinmap + 1) * sizeof(WinMap))))
+    die("replay: realloc:");
+  snprintf(name, sizeof name, "client %u", nwinmap);
+  winmap[nwinmap].id = id;
+  winmap[nwinmap].win = fakex_client(name, mapped);
+  return winmap[nwinmap++].win;
+}
+
+static Atom
+getatom(long a)
+{
+  if (a <= XA_LAST_PREDEFINED)
+    return a;
+  a -= XA_LAST_PREDEFINED + 1;
+  if (a < WMLast)
+    return wmatom[a];
+  if (a - WMLast < NetLast)
+    return netatom[a - WMLast];
+  return None;
+}
+
+#define GETF(X) X = get();
+#define GETW(X) X = getwin(get(), 0);
+#define GETA(X) X = getatom(get());
+#define GETK(X) X = XKeysymToKeycode(dpy, get());
+
+/* make the server agree with what the event announces */
+static void
+prepare(XEvent *ev)
+{
+  char text[256];
+  XEvent release;
+  size_t len;
+
+  switch(ev->type) {
+    case ButtonPress:
+      /* ends movemouse() and resizemouse() right away */
+      release = *ev;
+      release.type = ButtonRelease;
+      fakex_event(&release);
+      break;
+    case DestroyNotify:
+      fakex_destroy(ev->xdestroywindow.window);
+      break;
+    case PropertyNotify:
+      if (ev->xproperty.window == root && ev->xproperty.atom == XA_WM_NAME) {
+        if (pos < end && *pos == TraceSignal) {
+          pos++;
+          span += get();
+          len = get();
+          if (len > (size_t)(end - pos))
+            die("replay: truncated trace");
+          len = MIN(len, sizeof text - 1);
+          memcpy(text, pos, len);
+          pos += len;
+        } else
+          len = snprintf(text, sizeof text, "status %lu", nstatus++);
+        fakex_setprop(root, XA_WM_NAME, XA_STRING, 8, text, len);
+      } else if (ev->xproperty.atom == XA_WM_NAME || ev->xproperty.atom == netatom[NetWMName]) {
+        snprintf(text, sizeof text, "title %lu", nstatus++);
+        fakex_setname(ev->xproperty.window, text);
+      }
+      break;
+  }
+}
+
+static void
+replay(void)
+{
+  int type, scanned = 0;
+  long len, cmd;
+  unsigned long r, rt;
+  unsigned long long t;
+  XEvent ev;
+  Arg arg;
+  char str[IPCMSGSIZE];
+
+  while (pos < end && running) {
+    type = *pos++;
+    span += get();
+    if (type == TraceWindow) {
+      getwin(get(), 1);
+      continue;
+    }
+    if (!scanned) {
+      scan();
+      runpending();
+      scanned = 1;
+    }
+    if (type == TraceSignal) { /* without the root name change it came with */
+      if ((len = get()) < 0 || len > end - pos)
+        die("replay: truncated trace");
+      pos += len;
+      continue;
+    }
+    if (type == TraceCommand) {
+      if ((cmd = get()) < 0 || cmd >= (long)LENGTH(signals))
+        die("replay: bad command %ld", cmd);
+      type = get();
+      arg = (Arg){0};
+      if (type == IpcArgString) {
+        if ((len = get()) < 0 || len > end - pos || len >= (long)sizeof str)
+          die("replay: truncated trace");
+        memcpy(str, pos, len);
+        str[len] = '\0';
+        pos += len;
+        arg.v = str;
+      } else
+        arg.i = get();
+      r = fakex_requests();
+      rt = fakex_roundtrips();
+      t = getnsec();
+      ipcrun(signals[cmd].sig, strlen(signals[cmd].sig), type, &arg);
+      runpending();
+      t = getnsec() - t;
+      type = TraceCommand;
+    } else {
+      if (type >= LASTEvent || !handler[type])
+        die("replay: bad record type %d", type);
+      memset(&ev, 0, sizeof ev);
+      ev.type = type;
+      TRACEFIELDS(&ev, GETF, GETW, GETA, GETK)
+      prepare(&ev);
+      r = fakex_requests();
+      rt = fakex_roundtrips();
+      t = getnsec();
+      fakex_event(&ev);
+      xevents(ConnectionNumber(dpy));
+      runpending();
+      t = getnsec() - t;
+    }
+    stats[type].n++;
+    stats[type].t += t;
+    stats[type].max = MAX(stats[type].max, t);
+    stats[type].requests += fakex_requests() - r;
+    stats[type].roundtrips += fakex_roundtrips() - rt;
+  }
+}
+
+static void
+report(void)
+{
+  unsigned long n = 0;
+  unsigned long long t = 0;
+  unsigned int i;
+
+  for (i = 0; i < LENGTH(stats); i++) {
+    if (!stats[i].n)
+      continue;
+    printf("%-16s %8lu events %10.1f ns/event %10.1f max us %8.3f requests/event %8.3f round trips/event\n",
+        i == TraceCommand ? "command" : evname[i], stats[i].n, (double)stats[i].t / stats[i].n, stats[i].max / 1000.0,
+        (double)stats[i].requests / stats[i].n, (double)stats[i].roundtrips / stats[i].n);
+    n += stats[i].n;
+    t += stats[i].t;
+  }
+  printf("%lu events recorded over %.3f s replayed in %.3f ms\n", n, span / 1e6, t / 1e6);
+}
+
+int
+main(int argc, char *argv[])
+{
+  FILE *f;
+  long size;
+
+  if (argc != 2)
+    die("usage: replay file");
+  if (!(f = fopen(argv[1], "r")))
+    die("replay: cannot open %s:", argv[1]);
+  fseek(f, 0, SEEK_END);
+  if ((size = ftell(f)) == -1)
+    die("replay: %s:", argv[1]);
+  rewind(f);
+  buf = ecalloc(1, size + 1);
+  if (fread(buf, 1, size, f) != (size_t)size)
+    die("replay: cannot read %s:", argv[1]);
+  fclose(f);
+  if (size < (long)strlen(TRACEMAGIC) || memcmp(buf, TRACEMAGIC, strlen(TRACEMAGIC)))
+    die("replay: %s is not a dwm trace", argv[1]);
+  pos = buf + strlen(TRACEMAGIC);
+  end = buf + size;
+  setenv("DISPLAY", ":replay", 1); /* keep off the control socket of a running dwm */
+
+  if (!(dpy = XOpenDisplay(NULL)))
+    die("replay: cannot open display");
+  xcon = XGetXCBConnection(dpy);
+  setup();
+  fakex_reset();
+  replay();
+  report();
+  running = 1;
+  cleanup();
+  XCloseDisplay(dpy);
+  free(winmap);
+  free(buf);
+  return EXIT_SUCCESS;
+}
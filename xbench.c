@@ -0,0 +1,220 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * Benchmark of dwm's event handlers against the in-memory X server in
+ * fakex.c. dwm.c is included and set up as usual, then synthetic events are
+ * queued and dispatched through xevents() and runpending() exactly as the
+ * main loop would, so manage, focus, arrange, view and the bar all run
+ * their real code.
+ *
+ * Every line reports the nanoseconds, X requests and round trips per
+ * operation; with -v each line is followed by the requests made per call.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#define main dwmmain
+#include "dwm.c"
+#undef main
+
+#include "fakex.h"
+
+static const unsigned int nclients[] = { 1, 10, 100, 1000 };
+static int verbose;
+
+static void
+report(const char *what, unsigned int n, unsigned long ops, unsigned long long t)
+{
+  printf("%-12s %6u clients %12.1f ns/op %8.3f requests/op %8.3f round trips/op\n",
+      what, n, (double)t / ops, (double)fakex_requests() / ops,
+      (double)fakex_roundtrips() / ops);
+  if (verbose)
+    fakex_report(stdout, ops);
+}
+
+static unsigned int
+repsfor(unsigned int n)
+{
+  return MAX(20, 200000 / (n + 1));
+}
+
+static Window
+benchwin(unsigned int i, int mapped)
+{
+  char name[32];
+
+  snprintf(name, sizeof name, "client %u", i);
+  return fakex_client(name, mapped);
+}
+
+static void
+dispatch(XEvent *ev)
+{
+  fakex_event(ev);
+  xevents(ConnectionNumber(dpy));
+  runpending();
+}
+
+static void
+benchmap(Window *wins, unsigned int n)
+{
+  unsigned int i;
+  unsigned long long t;
+  XEvent ev = { .type = MapRequest };
+
+  for (i = 0; i < n; i++)
+    wins[i] = benchwin(i, 0);
+  fakex_reset();
+  t = getnsec();
+  for (i = 0; i < n; i++) {
+    ev.xmaprequest.window = wins[i];
+    dispatch(&ev);
+  }
+  t = getnsec() - t;
+  report("map", n, n, t);
+}
+
+static void
+benchfocusstack(unsigned int n)
+{
+  const Arg a = {.i = INC(+1)};
+  unsigned int i, reps = repsfor(n);
+  unsigned long long t;
+
+  fakex_reset();
+  t = getnsec();
+  for (i = 0; i < reps; i++) {
+    focusstack(&a);
+    runpending();
+  }
+  t = getnsec() - t;
+  report("focusstack", n, reps, t);
+}
+
+static void
+benchview(unsigned int n)
+{
+  const Arg a[] = { {.ui = 1 << 1}, {.ui = 1 << 0} };
+  unsigned int i, reps = repsfor(n);
+  unsigned long long t;
+
+  fakex_reset();
+  t = getnsec();
+  /* in pairs, so that the clients end up visible again */
+  for (i = 0; i < 2 * reps; i++) {
+    view(&a[i & 1]);
+    runpending();
+  }
+  t = getnsec() - t;
+  report("view", n, 2 * reps, t);
+}
+
+static void
+benchsetmfact(unsigned int n)
+{
+  const Arg a[] = { {.f = +0.05}, {.f = -0.05} };
+  unsigned int i, reps = repsfor(n);
+  unsigned long long t;
+
+  fakex_reset();
+  t = getnsec();
+  for (i = 0; i < reps; i++) {
+    setmfact(&a[i & 1]);
+    runpending();
+  }
+  t = getnsec() - t;
+  report("setmfact", n, reps, t);
+}
+
+static void
+benchtitle(unsigned int n)
+{
+  char name[32];
+  unsigned int i, reps = repsfor(n);
+  unsigned long long t;
+  XEvent ev = { .type = PropertyNotify };
+  Window w = selmon->sel->win;
+
+  ev.xproperty.window = w;
+  ev.xproperty.atom = netatom[NetWMName];
+  ev.xproperty.state = PropertyNewValue;
+  fakex_reset();
+  t = getnsec();
+  for (i = 0; i < reps; i++) {
+    snprintf(name, sizeof name, "title %u", i);
+    fakex_setname(w, name);
+    dispatch(&ev);
+  }
+  t = getnsec() - t;
+  report("title", n, reps, t);
+}
+
+static void
+benchdestroy(Window *wins, unsigned int n)
+{
+  unsigned int i;
+  unsigned long long t;
+  XEvent ev = { .type = DestroyNotify };
+
+  fakex_reset();
+  t = getnsec();
+  for (i = 0; i < n; i++) {
+    fakex_destroy(wins[i]);
+    ev.xdestroywindow.window = wins[i];
+    dispatch(&ev);
+  }
+  t = getnsec() - t;
+  report("destroy", n, n, t);
+}
+
+static void
+benchscan(Window *wins, unsigned int n)
+{
+  unsigned int i;
+  unsigned long long t;
+  XEvent ev = { .type = DestroyNotify };
+
+  for (i = 0; i < n; i++)
+    wins[i] = benchwin(i, 1);
+  fakex_reset();
+  t = getnsec();
+  scan();
+  runpending();
+  t = getnsec() - t;
+  report("scan", n, n, t);
+  for (i = 0; i < n; i++) {
+    fakex_destroy(wins[i]);
+    ev.xdestroywindow.window = wins[i];
+    dispatch(&ev);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  unsigned int i;
+  Window *wins;
+
+  if (argc == 2 && !strcmp("-v", argv[1]))
+    verbose = 1;
+  else if (argc != 1)
+    die("usage: xbench [-v]");
+  setenv("DISPLAY", ":xbench", 1); /* keep off the control socket of a running dwm */
+  if (!(dpy = XOpenDisplay(NULL)))
+    die("xbench: cannot open display");
+  xcon = XGetXCBConnection(dpy);
+  setup();
+  for (i = 0; i < LENGTH(nclients); i++) {
+    wins = ecalloc(nclients[i], sizeof(Window));
+    benchmap(wins, nclients[i]);
+    benchfocusstack(nclients[i]);
+    benchview(nclients[i]);
+    benchsetmfact(nclients[i]);
+    benchtitle(nclients[i]);
+    benchdestroy(wins, nclients[i]);
+    benchscan(wins, nclients[i]);
+    free(wins);
+  }
+  cleanup();
+  XCloseDisplay(dpy);
+  return EXIT_SUCCESS;
+}